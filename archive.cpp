@@ -1,20 +1,38 @@
 #include "archive.h"
+#include "checksum.h"
+#include "compress.h"
 #include "crypto.h"
+#include "io.h"
+#include "parallel.h"
+#include "pool.h"
 #include "sha3.h"
+#include "stats.h"
+#include <algorithm>
+#include <cctype>
 #include <filesystem>
-#include <fstream>
+#include <iomanip>
+#include <map>
 #include <random>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
 
-static std::string extension = ".dat";
-static std::string password;
+// ARCHIVE_OPTIONȂ֐g̐ݒ
+static ARCHIVE_OPTION default_option;
 
 struct ARCHIVE_HEADER {
 	size_t file_num;
 	uint16_t pass_md;
-	bool is_encrypted;
-	bool is_directory;
+	uint8_t cipher;
+	uint8_t flags;
 };
 
+constexpr uint8_t ARCHIVE_FLAG_DIRECTORY = 0x01;
+constexpr uint8_t ARCHIVE_FLAG_RESTART = 0x02;
+constexpr uint8_t ARCHIVE_FLAG_CRC32C = 0x04;
+constexpr uint8_t ARCHIVE_FLAG_SHA3 = 0x08;
+constexpr uint8_t ARCHIVE_FLAG_RAW = 0x10;	// kEÍȂŁAGgzlibʂɂ̂܂܊i[Ă
+
 struct FILE_HEADER {
 	size_t original_size;
 	size_t pressed_size;
@@ -22,7 +40,27 @@ struct FILE_HEADER {
 	size_t path_size;
 };
 
-static inline void XorBits(char* bits, size_t size)
+// JA[JCũGg̕\BpXׂ͂poolɑĒuApaths͂wB
+// 傫ƈʒu͍ڂƂ̔zɕĎiGgƂɕmۂA傫ɌƂɑ̍ڂǂ܂Ȃj
+struct ARCHIVE_DIRECTORY {
+	std::string pool;
+	std::vector<std::string_view> paths;
+	std::vector<size_t> original_size;
+	std::vector<size_t> pressed_size;
+	std::vector<size_t> pointer;
+
+	size_t size() const { return pointer.size(); }
+};
+
+// pX\̌ɑiÍ[htOɉď܂j
+struct ARCHIVE_EXTRA {
+	uint64_t salt;
+	std::vector<uint8_t> tags;
+	std::vector<std::vector<COMPRESS_RESTART>> restarts;
+	std::vector<uint8_t> checksums;
+};
+
+void XorBits(char* bits, size_t size)
 {
 	std::mt19937 engine(size);
 	for (size_t i = 0; i < size; i++) {
@@ -30,55 +68,705 @@ static inline void XorBits(char* bits, size_t size)
 	}
 }
 
-static inline uint16_t GetPassMD() {
+static inline uint16_t GetPassMD(const std::string& password) {
 	uint16_t md = 0; uint16_t hash[14];
-	SHA3_224(password.data(), password.size(), hash);
+	SHA3_224((void*)password.data(), password.size(), hash);
 	for (int i = 0; i < 14; i++) md ^= hash[i];
 	return md;
 }
 
-static size_t ReadHeader(std::ifstream& ifs, ARCHIVE_HEADER& header, std::vector<FILE_HEADER>& heads, std::vector<std::string>& paths)
+// Gǧ̌iSHA3-384(pX) XOR SHA3-384(pX[h)j48oCg܂Ƃ߂ċ߂
+static std::vector<uint8_t> GetEntryHashes(const std::string& password, const std::vector<std::string_view>& paths, STATS_SCOPE* stats)
+{
+	std::vector<const void*> data(paths.size());
+	std::vector<size_t> len(paths.size());
+	std::vector<uint8_t> hashes(48 * paths.size());
+	size_t total = 0;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		data[i] = paths[i].data();
+		len[i] = paths[i].size();
+		total += len[i];
+	}
+	STATS_SPAN span(stats, ARCHIVE_PHASE_KEY, total, hashes.size());
+	SHA3_384_xN(data.data(), len.data(), hashes.data(), paths.size());
+
+	uint8_t pass[48];
+	SHA3_384((uint8_t*)password.c_str(), password.size(), pass);
+	for (size_t i = 0; i < hashes.size(); i++) hashes[i] ^= pass[i % 48];
+	return hashes;
+}
+
+static void GetEntryKey(const uint8_t* hash, const ARCHIVE_HEADER& header, const ARCHIVE_EXTRA& extra, AesCtx& ctx, uint8_t* iv)
+{
+	AesInitKey(&ctx, hash, 32);
+	memcpy(iv, hash + 32, AES_BLOCK_BYTES);
+
+	// CTRGCM̓L[Xg[g񂷂ƕR̂ŁAA[JCuƂ̗mXɍ
+	if (header.cipher == ARCHIVE_CIPHER_CTR || header.cipher == ARCHIVE_CIPHER_GCM)
+		for (int i = 0; i < 8; i++) iv[i] ^= (uint8_t)(extra.salt >> (i * 8));
+}
+
+// Gg1̃`FbNT̃oCgiL^ĂȂ0j
+static size_t GetChecksumSize(const ARCHIVE_HEADER& header)
+{
+	return header.flags & ARCHIVE_FLAG_SHA3 ? 32 : header.flags & ARCHIVE_FLAG_CRC32C ? 4 : 0;
+}
+
+static void GetChecksum(const ARCHIVE_HEADER& header, const uint8_t* data, size_t size, uint8_t* out, STATS_SCOPE* stats)
+{
+	STATS_SPAN span(stats, ARCHIVE_PHASE_CHECKSUM, size);
+	if (header.flags & ARCHIVE_FLAG_SHA3) SHA3_256((void*)data, size, out);
+	else if (header.flags & ARCHIVE_FLAG_CRC32C)
+	{
+		const uint32_t crc = Crc32c(data, size);
+		memcpy(out, &crc, sizeof(crc));
+	}
+}
+
+static bool CheckChecksum(const ARCHIVE_HEADER& header, const ARCHIVE_EXTRA& extra, size_t index, const uint8_t* data, size_t size, STATS_SCOPE* stats)
+{
+	const size_t len = GetChecksumSize(header);
+	if (len == 0) return true;
+	uint8_t sum[32];
+	GetChecksum(header, data, size, sum, stats);
+	return memcmp(sum, &extra.checksums[len * index], len) == 0;
+}
+
+// Gg̍Ɨpobt@v[؂istatsɊmۂ񐔂Ƒ傫𐔂j
+static POOL_BUFFER AllocBuffer(STATS_SCOPE* stats, size_t size)
+{
+	StatsAlloc(stats, size);
+	return POOL_BUFFER(size);
+}
+
+static_assert(ARCHIVE_CIPHER_CBC == AES_MODE_CBC && ARCHIVE_CIPHER_CTR == AES_MODE_CTR && ARCHIVE_CIPHER_GCM == AES_MODE_GCM, "cipher ids are passed to AesStreamInit");
+
+// kf[^ԂƂ64KBȂWJAf[^LbVɂ邤inflate֓n
+// WJƃ`FbNTL^ĂΏƍ
+static bool UncompressEntry(const uint8_t* hash, const ARCHIVE_HEADER& header, const ARCHIVE_EXTRA& extra, size_t index, const uint8_t* pressed, size_t pressed_size, uint8_t* original, size_t original_size, STATS_SCOPE* stats, unsigned threads = 0)
+{
+	const auto& restarts = extra.restarts[index];
+	if (header.flags & ARCHIVE_FLAG_RAW)
+	{
+		if (pressed_size != original_size) return false;
+		memcpy(original, pressed, original_size);
+		return CheckChecksum(header, extra, index, original, original_size, stats);
+	}
+	if (header.cipher == ARCHIVE_CIPHER_NONE)
+	{
+		int ret;
+		{
+			STATS_SPAN span(stats, ARCHIVE_PHASE_COMPRESS, pressed_size, original_size);
+			ret = UncompressParallel(original, &original_size, pressed, pressed_size, restarts.data(), restarts.size(), threads, nullptr, stats);
+		}
+		return ret == Z_OK && CheckChecksum(header, extra, index, original, original_size, stats);
+	}
+
+	AesCtx ctx;
+	uint8_t iv[AES_BLOCK_BYTES];
+	GetEntryKey(hash, header, extra, ctx, iv);
+
+	// CBC̓pfBO̒m邽߂ɍŌ̃ubNɕ
+	size_t size = pressed_size;
+	if (header.cipher == ARCHIVE_CIPHER_CBC)
+	{
+		if (size < AES_BLOCK_BYTES || size % AES_BLOCK_BYTES) return false;
+		STATS_SPAN span(stats, ARCHIVE_PHASE_CRYPT, AES_BLOCK_BYTES, AES_BLOCK_BYTES);
+		AesStream last;
+		uint8_t block[AES_BLOCK_BYTES];
+		AesStreamInit(&last, &ctx, AES_MODE_CBC, true, iv, size - AES_BLOCK_BYTES, size > AES_BLOCK_BYTES ? pressed + size - AES_BLOCK_BYTES * 2 : nullptr);
+		AesStreamUpdate(&last, pressed + size - AES_BLOCK_BYTES, block, AES_BLOCK_BYTES);
+		if (block[AES_BLOCK_BYTES - 1] == 0 || block[AES_BLOCK_BYTES - 1] > AES_BLOCK_BYTES) return false;
+		size -= block[AES_BLOCK_BYTES - 1];
+	}
+
+	// ԂƂɃXg[AԂ̐擪܂ރubN畜BԂ̖ɂubN
+	// ̋Ԃ̂̂Ȃ̂ŁAXg[i߂ɕŕiGCM̃nbVdȂȂ悤Ɂj
+	std::vector<AesStream> streams(restarts.size() + 1);
+	auto filter = [&](size_t k, size_t offset, size_t len, uint8_t* out) {
+		AesStream& s = streams[k];
+		const size_t begin = offset / AES_BLOCK_BYTES * AES_BLOCK_BYTES, end = offset + len;
+		const size_t whole = end / AES_BLOCK_BYTES * AES_BLOCK_BYTES;
+		const size_t tail = whole < end ? std::min(whole + AES_BLOCK_BYTES, pressed_size) - whole : 0;
+		if (!s.Ctx) AesStreamInit(&s, &ctx, header.cipher, true, iv, begin, begin ? pressed + begin - AES_BLOCK_BYTES : nullptr);
+
+		STATS_SPAN span(stats, ARCHIVE_PHASE_CRYPT, whole + tail - begin, len);
+		POOL_BUFFER buffer = AllocBuffer(stats, whole + tail - begin);
+		AesStreamUpdate(&s, pressed + begin, buffer.data, whole - begin);
+		AesStream t = s;
+		AesStreamUpdate(end == pressed_size ? &s : &t, pressed + whole, buffer.data + whole - begin, tail);
+		memcpy(out, buffer.data + offset - begin, len);
+	};
+
+	{
+		STATS_SPAN span(stats, ARCHIVE_PHASE_COMPRESS, size, original_size);
+		if (UncompressParallel(original, &original_size, pressed, size, restarts.data(), restarts.size(), threads, filter, stats) != Z_OK) return false;
+	}
+	if (!CheckChecksum(header, extra, index, original, original_size, stats)) return false;
+	if (header.cipher != ARCHIVE_CIPHER_GCM) return true;
+
+	uint8_t tag[AES_BLOCK_BYTES];
+	for (size_t k = 1; k < streams.size(); k++) AesStreamJoin(&streams[0], &streams[k]);
+	AesStreamTag(&streams[0], tag);
+	return memcmp(tag, &extra.tags[AES_BLOCK_BYTES * index], AES_BLOCK_BYTES) == 0;
+}
+
+// GCM̃Gg̃^OWJɏƍBm߂邾̂ƂɎgA`FbNT͓WJȂƋ܂Ȃ̂ŌȂ
+static bool VerifyEntryTag(const uint8_t* hash, const ARCHIVE_HEADER& header, const ARCHIVE_EXTRA& extra, size_t index, const uint8_t* pressed, size_t pressed_size, STATS_SCOPE* stats, unsigned threads = 0)
 {
-	ifs.seekg(0, std::ios_base::beg);
+	AesCtx ctx;
+	uint8_t iv[AES_BLOCK_BYTES];
+	GetEntryKey(hash, header, extra, ctx, iv);
+	STATS_SPAN span(stats, ARCHIVE_PHASE_CRYPT, pressed_size);
+	return AesVerifyGcm(&ctx, iv, pressed, pressed_size, &extra.tags[AES_BLOCK_BYTES * index], threads);
+}
 
-	ifs.read((char*)&header, sizeof(ARCHIVE_HEADER));
+static size_t ReadHeader(IO_READER& r, const std::string& password, ARCHIVE_HEADER& header, ARCHIVE_DIRECTORY& dir, ARCHIVE_EXTRA& extra)
+{
+	if (!IoReaderRead(&r, &header, sizeof(ARCHIVE_HEADER))) return 0;
 	XorBits((char*)&header, sizeof(ARCHIVE_HEADER));
 
-	if (header.pass_md != GetPassMD()) return 0;
+	if (header.pass_md != GetPassMD(password)) return 0;
 
-	heads.resize(header.file_num);
-	ifs.read((char*)heads.data(), (uint64_t)sizeof(FILE_HEADER) * header.file_num);
+	std::vector<FILE_HEADER> heads(header.file_num);
+	if (!IoReaderRead(&r, heads.data(), (uint64_t)sizeof(FILE_HEADER) * header.file_num)) return 0;
 	XorBits((char*)heads.data(), (uint64_t)sizeof(FILE_HEADER) * header.file_num);
 
-	paths.resize(header.file_num);
+	dir.original_size.resize(header.file_num);
+	dir.pressed_size.resize(header.file_num);
+	dir.pointer.resize(header.file_num);
+	size_t pool_size = 0;
 	for (size_t i = 0; i < header.file_num; i++)
 	{
-		paths[i].resize(heads[i].path_size);
-		ifs.read(paths[i].data(), heads[i].path_size);
-		XorBits((char*)paths[i].data(), heads[i].path_size);
+		dir.original_size[i] = heads[i].original_size;
+		dir.pressed_size[i] = heads[i].pressed_size;
+		dir.pointer[i] = heads[i].pointer;
+		pool_size += heads[i].path_size;
+	}
+
+	// pX͂܂Ƃ߂1œǂށBXorBits̓pXƂɒŏ̂ŁAقǂ̂̓pXƂɍs
+	dir.pool.resize(pool_size);
+	if (!IoReaderRead(&r, dir.pool.data(), pool_size)) return 0;
+	dir.paths.resize(header.file_num);
+	for (size_t i = 0, offset = 0; i < header.file_num; offset += heads[i].path_size, i++)
+	{
+		XorBits(dir.pool.data() + offset, heads[i].path_size);
+		dir.paths[i] = std::string_view(dir.pool.data() + offset, heads[i].path_size);
+	}
+
+	extra.salt = 0;
+	if (header.cipher == ARCHIVE_CIPHER_CTR || header.cipher == ARCHIVE_CIPHER_GCM)
+	{
+		if (!IoReaderRead(&r, &extra.salt, sizeof(extra.salt))) return 0;
+		XorBits((char*)&extra.salt, sizeof(extra.salt));
+	}
+
+	extra.tags.clear();
+	if (header.cipher == ARCHIVE_CIPHER_GCM)
+	{
+		extra.tags.resize((uint64_t)AES_BLOCK_BYTES * header.file_num);
+		if (!IoReaderRead(&r, extra.tags.data(), extra.tags.size())) return 0;
+		XorBits((char*)extra.tags.data(), extra.tags.size());
+	}
+
+	auto& restarts = extra.restarts;
+	restarts.assign(header.file_num, {});
+	if (header.flags & ARCHIVE_FLAG_RESTART)
+	{
+		std::vector<size_t> restart_num(header.file_num);
+		if (!IoReaderRead(&r, restart_num.data(), sizeof(size_t) * header.file_num)) return 0;
+		XorBits((char*)restart_num.data(), sizeof(size_t) * header.file_num);
+		for (size_t i = 0; i < header.file_num; i++)
+		{
+			if (restart_num[i] == 0) continue;
+			restarts[i].resize(restart_num[i]);
+			if (!IoReaderRead(&r, restarts[i].data(), sizeof(COMPRESS_RESTART) * restart_num[i])) return 0;
+			XorBits((char*)restarts[i].data(), sizeof(COMPRESS_RESTART) * restart_num[i]);
+		}
+	}
+
+	extra.checksums.resize(GetChecksumSize(header) * header.file_num);
+	if (!extra.checksums.empty())
+	{
+		if (!IoReaderRead(&r, extra.checksums.data(), extra.checksums.size())) return 0;
+		XorBits((char*)extra.checksums.data(), extra.checksums.size());
 	}
 
-	return (size_t)ifs.tellg();
+	return (size_t)IoReaderTell(&r);
 }
-static void WriteHeader(std::ofstream& ofs, ARCHIVE_HEADER& header, std::vector<FILE_HEADER>& heads, std::vector<std::string>& paths)
+static void WriteHeader(IO_WRITER& w, ARCHIVE_HEADER& header, std::vector<FILE_HEADER>& heads, std::vector<std::string>& paths, ARCHIVE_EXTRA& extra)
 {
+	const bool has_salt = header.cipher == ARCHIVE_CIPHER_CTR || header.cipher == ARCHIVE_CIPHER_GCM;
+	const bool has_tag = header.cipher == ARCHIVE_CIPHER_GCM;
+	const bool has_restart = header.flags & ARCHIVE_FLAG_RESTART;
+	std::vector<uint8_t> checksums = extra.checksums;
+	auto& restarts = extra.restarts;
+	std::vector<size_t> restart_num(restarts.size());
+	for (size_t i = 0; i < restarts.size(); i++) restart_num[i] = restarts[i].size();
+
 	XorBits((char*)&header, sizeof(ARCHIVE_HEADER));
 	XorBits((char*)heads.data(), (uint64_t)sizeof(FILE_HEADER) * heads.size());
 	for (size_t i = 0; i < paths.size(); i++) XorBits(paths[i].data(), paths[i].size());
 
-	ofs.write((char*)&header, sizeof(ARCHIVE_HEADER));
-	ofs.write((char*)heads.data(), (uint64_t)sizeof(FILE_HEADER) * heads.size());
-	for (size_t i = 0; i < paths.size(); i++) ofs.write(paths[i].c_str(), paths[i].size());
+	IoWriterWrite(&w, &header, sizeof(ARCHIVE_HEADER));
+	IoWriterWrite(&w, heads.data(), (uint64_t)sizeof(FILE_HEADER) * heads.size());
+	for (size_t i = 0; i < paths.size(); i++) IoWriterWrite(&w, paths[i].c_str(), paths[i].size());
+
+	if (has_salt)
+	{
+		uint64_t salt = extra.salt;
+		XorBits((char*)&salt, sizeof(salt));
+		IoWriterWrite(&w, &salt, sizeof(salt));
+	}
+
+	if (has_tag)
+	{
+		std::vector<uint8_t> tags = extra.tags;
+		XorBits((char*)tags.data(), tags.size());
+		IoWriterWrite(&w, tags.data(), tags.size());
+	}
+
+	if (has_restart)
+	{
+		XorBits((char*)restart_num.data(), sizeof(size_t) * restart_num.size());
+		IoWriterWrite(&w, restart_num.data(), sizeof(size_t) * restart_num.size());
+		for (auto& r : restarts)
+		{
+			if (r.empty()) continue;
+			XorBits((char*)r.data(), sizeof(COMPRESS_RESTART) * r.size());
+			IoWriterWrite(&w, r.data(), sizeof(COMPRESS_RESTART) * r.size());
+		}
+	}
+
+	if (checksums.empty()) return;
+	XorBits((char*)checksums.data(), checksums.size());
+	IoWriterWrite(&w, checksums.data(), checksums.size());
+}
+
+// WriteHeadero傫Brestart_total͑SGgrestarts̐̍v
+static size_t GetHeaderSize(const ARCHIVE_HEADER& header, const std::vector<std::string>& paths, size_t restart_total)
+{
+	size_t size = sizeof(ARCHIVE_HEADER) + sizeof(FILE_HEADER) * paths.size();
+	for (const auto& path : paths) size += path.size();
+	if (header.cipher == ARCHIVE_CIPHER_CTR || header.cipher == ARCHIVE_CIPHER_GCM) size += sizeof(uint64_t);
+	if (header.cipher == ARCHIVE_CIPHER_GCM) size += AES_BLOCK_BYTES * paths.size();
+	if (header.flags & ARCHIVE_FLAG_RESTART) size += sizeof(size_t) * paths.size() + sizeof(COMPRESS_RESTART) * restart_total;
+	return size + GetChecksumSize(header) * paths.size();
+}
+
+static bool IsSeparator(char c)
+{
+	return c == '\\' || c == '/';
+}
+
+// ł͋؂\/𓯂ƂĔׂiWindowsňkA[JCu𑼂̊ŒTĂA̋tłv悤Ɂj
+static unsigned char PathChar(char c)
+{
+	return IsSeparator(c) ? '/' : (unsigned char)c;
+}
+
+static bool PathEqual(std::string_view a, std::string_view b)
+{
+	return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) { return PathChar(x) == PathChar(y); });
+}
+
+// index̃L[̃nbVƔriPathCharŋ؂𑵂ĂvZj
+struct PATH_HASH {
+	size_t operator()(std::string_view path) const
+	{
+		uint64_t h = 14695981039346656037ULL;
+		for (char c : path) h = (h ^ PathChar(c)) * 1099511628211ULL;
+		return (size_t)h;
+	}
+};
+
+struct PATH_EQUAL {
+	bool operator()(std::string_view a, std::string_view b) const { return PathEqual(a, b); }
+};
+
+// JA[JCuBwb_͊JƂɓǂݍ݁AȌ͕ύXȂ̂ŕ̃Xbh瓯ɓǂ߂
+struct ARCHIVE {
+	std::filesystem::path path;
+	std::string password;
+	ARCHIVE_HEADER header;
+	ARCHIVE_DIRECTORY dir;
+	ARCHIVE_EXTRA extra;
+	size_t head_size;
+	IO_FILE* file;	// ʒuw肵ēǂނ̂łׂẴXbhŋL
+	ARCHIVE_STATS* stats;	// GgǂݏoтɓZiARCHIVE_OPTION::statsj
+	ARCHIVE_TRACE* trace;
+	std::unordered_map<std::string_view, size_t, PATH_HASH, PATH_EQUAL> index;	// Gg̃pXԍiL[dir.poolwj
+	std::vector<size_t> order;	// Gg̔ԍpX̎ɕׂ́iOvŒT߁BpX͐̂̂j
+};
+
+// ̃A[JCu܂Ƃ߂́Bindex͌ォ}EgA[JCũGgŏ㏑Ă
+struct ARCHIVE_MOUNT {
+	std::vector<ARCHIVE*> archives;
+	std::unordered_map<std::string_view, std::pair<size_t, size_t>, PATH_HASH, PATH_EQUAL> index;	// pX(A[JCu, Gg)
+};
+
+// option.rootɃpXirootȂJgfBNgj
+static std::filesystem::path ResolvePath(const ARCHIVE_OPTION& option, const std::string& path)
+{
+	return option.root.empty() ? std::filesystem::path(path) : std::filesystem::path(option.root) / path;
+}
+
+// GgǂݍœWJ
+static bool ReadEntry(const ARCHIVE* archive, size_t index, const uint8_t* hash, uint8_t* dest, STATS_SCOPE* stats, unsigned threads = 0)
+{
+	const ARCHIVE_DIRECTORY& dir = archive->dir;
+	const size_t original_size = dir.original_size[index], pressed_size = dir.pressed_size[index];
+	const uint64_t pointer = (uint64_t)archive->head_size + dir.pointer[index];
+	if (archive->header.flags & ARCHIVE_FLAG_RAW)
+	{
+		if (pressed_size != original_size) return false;
+		{
+			STATS_SPAN span(stats, ARCHIVE_PHASE_READ, original_size);
+			if (!IoRead(archive->file, dest, original_size, pointer)) return false;
+		}
+		return CheckChecksum(archive->header, archive->extra, index, dest, original_size, stats);
+	}
+
+	POOL_BUFFER pressed = AllocBuffer(stats, pressed_size);
+	{
+		STATS_SPAN span(stats, ARCHIVE_PHASE_READ, pressed_size);
+		if (!IoRead(archive->file, pressed.data, pressed_size, pointer)) return false;
+	}
+	return UncompressEntry(hash, archive->header, archive->extra, index, pressed.data, pressed.size, dest, original_size, stats, threads);
+}
+
+// ARCHIVE_OPTION::callbackɃCxg𑗂Ai݋𐔂BEND𑗂炸ɔƂ͎sƂđ
+struct ARCHIVE_NOTIFY {
+	ARCHIVE_CALLBACK callback;
+	void* user;
+	ARCHIVE_EVENT event;
+	bool ended;
+
+	ARCHIVE_NOTIFY(const ARCHIVE_OPTION& option) : callback(option.callback), user(option.callback_user), event{}, ended(false) {}
+	~ARCHIVE_NOTIFY() { End(false); }
+
+	void Begin(size_t files, uint64_t bytes)
+	{
+		event.files_total = files;
+		event.bytes_total = bytes;
+		Send(ARCHIVE_EVENT_BEGIN, {}, 0, 0, true);
+	}
+	void EntryBegin(std::string_view path)
+	{
+		Send(ARCHIVE_EVENT_ENTRY_BEGIN, path, 0, 0, true);
+	}
+	void EntryEnd(std::string_view path, uint64_t original, uint64_t pressed, bool ok)
+	{
+		event.files_done++;
+		event.bytes_done += original;
+		event.pressed_done += pressed;
+		Send(ARCHIVE_EVENT_ENTRY_END, path, original, pressed, ok);
+	}
+	bool End(bool ok)
+	{
+		if (!ended) Send(ARCHIVE_EVENT_END, {}, 0, 0, ok);
+		ended = true;
+		return ok;
+	}
+
+private:
+	void Send(ARCHIVE_EVENT_TYPE type, std::string_view path, uint64_t original, uint64_t pressed, bool ok)
+	{
+		if (!callback) return;
+		event.type = type;
+		event.path = path;
+		event.original_size = original;
+		event.pressed_size = pressed;
+		event.ok = ok;
+		callback(event, user);
+	}
+};
+
+// WJƌ؂ňxɓǂݍނ܂Ƃ܂̑傫ikƓWJ̍vjƁAɔsǂݏ̐
+constexpr size_t ARCHIVE_BATCH_SIZE = 32 * 1024 * 1024;
+constexpr unsigned ARCHIVE_QUEUE_DEPTH = 64;
+// ȉ̃t@C̓XbhƂɊJďĕBȏ0͏܂Ɍɂ
+constexpr size_t ARCHIVE_SMALL_FILE = 64 * 1024;
+constexpr size_t ARCHIVE_HOLE_SIZE = 64 * 1024;
+
+// 0łȂ[Jn, I)ԂBIO_ALIGÑubNPʂŒׁAARCHIVE_HOLE_SIZEȏ㑱0΂
+static std::vector<std::pair<size_t, size_t>> GetDataExtents(const uint8_t* data, size_t size)
+{
+	auto is_zero = [&](size_t offset, size_t len) {
+		uint64_t bits = 0, word;
+		for (size_t i = 0; i + 8 <= len; i += 8) { memcpy(&word, data + offset + i, 8); bits |= word; }
+		for (size_t i = len / 8 * 8; i < len; i++) bits |= data[offset + i];
+		return bits == 0;
+	};
+
+	std::vector<std::pair<size_t, size_t>> extents;
+	size_t begin = 0, zero = 0;	// zero0n߂ʒu
+	for (size_t offset = 0; offset < size; offset += IO_ALIGN)
+	{
+		const size_t len = std::min(IO_ALIGN, size - offset);
+		if (!is_zero(offset, len)) zero = offset + len;
+		else if (offset + len - zero >= ARCHIVE_HOLE_SIZE && (offset + len == size || !is_zero(offset + len, std::min(IO_ALIGN, size - offset - len))))
+		{
+			if (zero > begin) extents.push_back({ begin, zero });
+			begin = zero = offset + len;
+		}
+	}
+	if (begin < size) extents.push_back({ begin, size });
+	return extents;
+}
+
+// entries̃Ggɂ܂Ƃ܂育ƂIO_QUEUEœǂݍœWJB܂Ƃ܂WJĂԂɁA
+// ̂܂Ƃ܂̓ǂݍ݂ƑÔ܂Ƃ܂̏oi߂ĂBentries̓A[JCu̒̈ʒȕɕׂĂA
+// hashesɂentries̏Ɍׂ̌B
+// first_dirnullptrȂm߂邾ŏoiGCM̓^Ȍƍōς܂ēWJȂjAłȂ΍ŏɉꂽGgŎ~߂B
+// ̂܂܊i[GgoƂ͓ǂݍ܂ɃA[JCuJ[l̒ŃRs[i`FbNT͊m߂Ȃj
+static bool ExtractEntries(const ARCHIVE* archive, const std::vector<size_t>& entries, const std::vector<uint8_t>& hashes, const std::filesystem::path* first_dir, std::vector<uint8_t>& ok, STATS_SCOPE* stats, ARCHIVE_NOTIFY& notify)
+{
+	const ARCHIVE_DIRECTORY& dir = archive->dir;
+	const size_t count = dir.size();
+	const bool copy = first_dir && (archive->header.flags & ARCHIVE_FLAG_RAW);
+	const bool tag_only = !first_dir && archive->header.cipher == ARCHIVE_CIPHER_GCM;
+	// boundsentries̒̈ʒuŋ؂
+	std::vector<size_t> bounds{ 0 };
+	for (size_t n = 0, size = 0; n < entries.size(); n++)
+	{
+		const size_t i = entries[n];
+		const size_t s = copy ? 0 : tag_only ? dir.pressed_size[i] : dir.pressed_size[i] + dir.original_size[i];
+		if (n > bounds.back() && size + s > ARCHIVE_BATCH_SIZE)
+		{
+			bounds.push_back(n);
+			size = 0;
+		}
+		size += s;
+	}
+	bounds.push_back(entries.size());
+
+	// ǂݍ݂tag̓Gg̔ԍ*2Ao*2+1Bo̓t@CƂwrites̐s
+	std::vector<POOL_BUFFER> pressed(count), original(count);
+	std::vector<IO_FILE*> files(count);
+	std::vector<size_t> writes(count);
+	std::vector<uint8_t> ready(count);
+	IO_QUEUE* queue = IoQueueCreate(ARCHIVE_QUEUE_DEPTH);
+	bool written = true;
+	auto reap = [&]() {
+		uint64_t tag;
+		bool done;
+		if (!IoQueueWait(queue, &tag, &done)) return false;
+		const size_t i = (size_t)(tag >> 1);
+		if (tag & 1)
+		{
+			written = written && done;
+			if (--writes[i]) return true;
+			IoClose(files[i]);
+			files[i] = nullptr;
+			original[i] = POOL_BUFFER();
+		}
+		else ready[i] = done ? 1 : 2;
+		return true;
+	};
+
+	// fBNgoĂAfBNg̃t@CƂɃt@CVXeɖ₢킹Ȃ
+	std::unordered_set<std::string> dirs;
+	auto make_dir = [&](const std::filesystem::path& dir) {
+		if (dir.empty() || !dirs.insert(dir.string()).second) return;
+		if (!std::filesystem::exists(dir)) std::filesystem::create_directories(dir);
+	};
+	auto read = [&](size_t k) {
+		for (size_t n = bounds[k]; n < bounds[k + 1]; n++)
+		{
+			const size_t i = entries[n];
+			if (copy)
+			{
+				ready[i] = 1;
+				continue;
+			}
+			pressed[i] = AllocBuffer(stats, dir.pressed_size[i]);
+			StatsBytes(stats, ARCHIVE_PHASE_READ, dir.pressed_size[i], 0);
+			while (!IoQueueRead(queue, archive->file, pressed[i].data, pressed[i].size, (uint64_t)archive->head_size + dir.pointer[i], (uint64_t)i << 1)) reap();
+		}
+		IoQueueSubmit(queue);
+	};
+	auto decode = [&](size_t n, unsigned threads) {
+		const size_t i = entries[n];
+		if (copy)
+		{
+			ok[i] = dir.pressed_size[i] == dir.original_size[i];
+			return;
+		}
+		if (tag_only)
+		{
+			ok[i] = ready[i] == 1 && VerifyEntryTag(&hashes[48 * n], archive->header, archive->extra, i, pressed[i].data, pressed[i].size, stats, threads);
+			pressed[i] = POOL_BUFFER();
+			return;
+		}
+		original[i] = AllocBuffer(stats, dir.original_size[i]);
+		ok[i] = ready[i] == 1 && UncompressEntry(&hashes[48 * n], archive->header, archive->extra, i, pressed[i].data, pressed[i].size, original[i].data, dir.original_size[i], stats, threads);
+		pressed[i] = POOL_BUFFER();
+	};
+
+	ok.assign(count, 0);
+	bool result = true;
+	read(0);
+	for (size_t k = 0; k + 1 < bounds.size() && (result || !first_dir); k++)
+	{
+		const size_t begin = bounds[k], end = bounds[k + 1];
+		{
+			STATS_SPAN span(stats, ARCHIVE_PHASE_WAIT);
+			for (size_t n = begin; n < end; n++) while (!ready[entries[n]]) reap();
+		}
+		if (k + 2 < bounds.size()) read(k + 1);
+
+		// Ԃɕꂽ傫Gg1ԂƂɕŁAȊO̓GgƂɕœWJ
+		for (size_t n = begin; n < end; n++) notify.EntryBegin(dir.paths[entries[n]]);
+		std::vector<size_t> large, small;
+		for (size_t n = begin; n < end; n++) (archive->extra.restarts[entries[n]].empty() ? small : large).push_back(n);
+		for (size_t n : large) decode(n, 0);
+		ParallelFor(small.size(), [&](size_t n) { decode(small[n], 1); });
+
+		// 傫t@C͗̈mۂ邩󂯂IO_QUEUEŏAt@CƃRs[t@C͂܂Ƃ߂ĕŏ
+		STATS_SPAN span(stats, ARCHIVE_PHASE_WRITE);
+		std::vector<size_t> direct_files;
+		for (size_t n = begin; n < end; n++)
+		{
+			const size_t i = entries[n];
+			if (!ok[i]) result = false;
+			notify.EntryEnd(dir.paths[i], dir.original_size[i], dir.pressed_size[i], ok[i]);
+			if (!first_dir || !result)
+			{
+				original[i] = POOL_BUFFER();
+				if (first_dir) break;
+				continue;
+			}
+
+
+			const std::filesystem::path out = archive->path.parent_path() / *first_dir / dir.paths[i];
+			make_dir(out.parent_path());
+			if (copy || dir.original_size[i] <= ARCHIVE_SMALL_FILE)
+			{
+				direct_files.push_back(i);
+				continue;
+			}
+
+			files[i] = IoOpen(out, true);
+			if (!files[i])
+			{
+				result = false;
+				break;
+			}
+			const auto extents = GetDataExtents(original[i].data, dir.original_size[i]);
+			const bool sparse = extents.size() != 1 || extents[0].first != 0 || extents[0].second != dir.original_size[i];
+			if (sparse)
+			{
+				IoSetSparse(files[i]);
+				written = IoTruncate(files[i], dir.original_size[i]) && written;
+			}
+			else IoAllocate(files[i], dir.original_size[i]);
+
+			// S0̃t@C͏ނ̂Ȃ
+			if (extents.empty())
+			{
+				IoClose(files[i]);
+				files[i] = nullptr;
+				original[i] = POOL_BUFFER();
+				continue;
+			}
+			writes[i] = extents.size();
+			for (const auto& e : extents)
+			{
+				StatsBytes(stats, ARCHIVE_PHASE_WRITE, 0, e.second - e.first);
+				while (!IoQueueWrite(queue, files[i], original[i].data + e.first, e.second - e.first, e.first, (uint64_t)i << 1 | 1)) reap();
+			}
+		}
+		IoQueueSubmit(queue);
+
+		std::vector<uint8_t> direct_written(direct_files.size());
+		ParallelFor(direct_files.size(), [&](size_t n) {
+			const size_t i = direct_files[n];
+			STATS_SPAN span(stats, ARCHIVE_PHASE_WRITE, 0, dir.original_size[i]);
+			if (copy) StatsBytes(stats, ARCHIVE_PHASE_READ, dir.original_size[i], 0);
+			IO_FILE* file = IoOpen(archive->path.parent_path() / *first_dir / dir.paths[i], true);
+			if (copy) direct_written[n] = file && IoCopy(archive->file, (uint64_t)archive->head_size + dir.pointer[i], file, 0, dir.original_size[i]);
+			else direct_written[n] = file && IoWrite(file, original[i].data, dir.original_size[i], 0);
+			IoClose(file);
+			original[i] = POOL_BUFFER();
+		});
+		for (uint8_t w : direct_written) written = written && w;
+	}
+
+	{
+		STATS_SPAN span(stats, ARCHIVE_PHASE_WAIT);
+		while (reap());
+	}
+	IoQueueDestroy(queue);
+	return result && written;
 }
 
 void SetArchivePassword(const std::string& _pass)
 {
-	password = _pass;
+	default_option.password = _pass;
 }
 
 void SetArchiveExtension(const std::string& _extension)
 {
-	extension = _extension;
+	default_option.extension = _extension;
+}
+
+void SetArchiveCipher(ARCHIVE_CIPHER _cipher)
+{
+	default_option.cipher = _cipher;
+}
+
+void SetArchiveChecksum(ARCHIVE_CHECKSUM _checksum)
+{
+	default_option.checksum = _checksum;
+}
+
+void SetArchiveStats(ARCHIVE_STATS* _stats)
+{
+	default_option.stats = _stats;
+}
+
+void SetArchiveTrace(ARCHIVE_TRACE* _trace)
+{
+	default_option.trace = _trace;
+}
+
+void SetArchiveCallback(ARCHIVE_CALLBACK _callback, void* _user)
+{
+	default_option.callback = _callback;
+	default_option.callback_user = _user;
+}
+
+void SetArchiveLevelGoal(ARCHIVE_LEVEL_GOAL _goal, double _min_pack_speed, double _read_speed)
+{
+	default_option.level_goal = _goal;
+	default_option.min_pack_speed = _min_pack_speed;
+	default_option.read_speed = _read_speed;
+}
+
+void SetArchiveLevelChoices(std::vector<ARCHIVE_LEVEL_CHOICE>* _choices)
+{
+	default_option.level_choices = _choices;
+}
+
+void PrintArchiveLevelChoices(const std::vector<ARCHIVE_LEVEL_CHOICE>& choices, std::ostream& out)
+{
+	auto strategy_name = [](int strategy) {
+		return strategy == Z_FILTERED ? "filtered" : strategy == Z_HUFFMAN_ONLY ? "huffman" : strategy == Z_RLE ? "rle" : strategy == Z_FIXED ? "fixed" : "default";
+	};
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+	out << std::fixed << std::setprecision(1);
+	out << std::setw(10) << "type" << std::setw(8) << "files" << std::setw(7) << "level" << std::setw(10) << "strategy"
+		<< std::setw(10) << "ratio (%)" << std::setw(14) << "pack (MB/s)" << std::setw(14) << "unpack (MB/s)" << std::endl;
+	for (const ARCHIVE_LEVEL_CHOICE& c : choices)
+	{
+		out << std::setw(10) << (c.type.empty() ? "(none)" : c.type) << std::setw(8) << c.files << std::setw(7) << c.level << std::setw(10) << strategy_name(c.strategy)
+			<< std::setw(10) << c.ratio * 100 << std::setw(14) << c.pack_speed << std::setw(14) << c.unpack_speed << std::endl;
+	}
+	out.flags(flags);
+	out.precision(precision);
 }
 
 bool GetFileList(std::string path, std::vector<std::string>& list)
@@ -88,224 +776,604 @@ bool GetFileList(std::string path, std::vector<std::string>& list)
 	return true;
 }
 
-bool EncodeArchive(std::string path, int _compress_level, bool _encrypt)
+bool GetFileList(const ARCHIVE* archive, std::vector<std::string>& list)
+{
+	list.insert(list.end(), archive->dir.paths.begin(), archive->dir.paths.end());
+	return true;
+}
+
+static bool PathLess(std::string_view a, std::string_view b)
+{
+	return std::lexicographical_compare(a.begin(), a.end(), b.begin(), b.end(), [](char x, char y) { return PathChar(x) < PathChar(y); });
+}
+
+// *͋؂܂ɁA**͂܂ŔCӂ̕ɈvB?͋؂ȊO1ɈvB
+// **̒̋؂͏ȂĂ悢imaps\**\*.pngmaps\a.pngɂvj
+static bool MatchPattern(std::string_view pattern, std::string_view path)
+{
+	while (!pattern.empty())
+	{
+		if (pattern[0] == '*')
+		{
+			const bool any = pattern.size() > 1 && pattern[1] == '*';
+			pattern.remove_prefix(any ? 2 : 1);
+			if (any && !pattern.empty() && IsSeparator(pattern[0]) && MatchPattern(pattern.substr(1), path)) return true;
+			for (size_t n = 0; ; n++)
+			{
+				if (MatchPattern(pattern, path.substr(n))) return true;
+				if (n == path.size() || (!any && IsSeparator(path[n]))) return false;
+			}
+		}
+		if (path.empty() || (pattern[0] == '?' ? IsSeparator(path[0]) : PathChar(pattern[0]) != PathChar(path[0]))) return false;
+		pattern.remove_prefix(1);
+		path.remove_prefix(1);
+	}
+	return path.empty();
+}
+
+// prefixŎn܂pXorder͈̒̔[first, last)
+static std::pair<size_t, size_t> GetPrefixRange(const ARCHIVE* archive, std::string_view prefix)
+{
+	const auto& paths = archive->dir.paths;
+	const auto first = std::lower_bound(archive->order.begin(), archive->order.end(), prefix, [&](size_t i, std::string_view p) { return PathLess(paths[i], p); });
+	const auto last = std::partition_point(first, archive->order.end(), [&](size_t i) { return PathEqual(paths[i].substr(0, prefix.size()), prefix); });
+	return { (size_t)(first - archive->order.begin()), (size_t)(last - archive->order.begin()) };
+}
+
+// patternɈvGg̔ԍpX̎ɕԂBŏ̃ChJ[hO̕Ŕ͈͂iĂ璲ׂ
+static std::vector<size_t> FindEntries(const ARCHIVE* archive, std::string_view pattern)
+{
+	const auto range = GetPrefixRange(archive, pattern.substr(0, pattern.find_first_of("*?")));
+	std::vector<size_t> entries;
+	for (size_t n = range.first; n < range.second; n++)
+	{
+		const size_t i = archive->order[n];
+		if (MatchPattern(pattern, archive->dir.paths[i])) entries.push_back(i);
+	}
+	return entries;
+}
+
+bool GetFileList(const ARCHIVE* archive, const std::string& prefix, std::vector<std::string>& list)
+{
+	const auto range = GetPrefixRange(archive, prefix);
+	for (size_t n = range.first; n < range.second; n++) list.emplace_back(archive->dir.paths[archive->order[n]]);
+	return range.first != range.second;
+}
+
+bool GetChildList(const ARCHIVE* archive, const std::string& dir, std::vector<std::string>& list)
+{
+	std::string prefix = dir;
+	if (!prefix.empty() && !IsSeparator(prefix.back())) prefix += '\\';
+
+	// fBNg̉ɂpX͎ő̂ŁAOƓOłȂΒǉ
+	const auto range = GetPrefixRange(archive, prefix);
+	std::string_view last;
+	for (size_t n = range.first; n < range.second; n++)
+	{
+		std::string_view name = archive->dir.paths[archive->order[n]].substr(prefix.size());
+		const size_t pos = std::find_if(name.begin(), name.end(), IsSeparator) - name.begin();
+		if (pos < name.size()) name = name.substr(0, pos + 1);
+		if (name.empty() || PathEqual(name, last)) continue;
+		list.emplace_back(name);
+		last = name;
+	}
+	return range.first != range.second;
+}
+
+bool MatchFileList(const ARCHIVE* archive, const std::string& pattern, std::vector<std::string>& list)
+{
+	const std::vector<size_t> entries = FindEntries(archive, pattern);
+	for (size_t i : entries) list.emplace_back(archive->dir.paths[i]);
+	return !entries.empty();
+}
+
+// wb_ǂގԂ͌Ăяostatsɐ
+static ARCHIVE* OpenArchive(const ARCHIVE_OPTION& option, const std::string& path, STATS_SCOPE* stats)
+{
+	ARCHIVE* archive = new ARCHIVE;
+	archive->path = ResolvePath(option, path);
+	archive->password = option.password;
+	archive->stats = option.stats;
+	archive->trace = option.trace;
+	archive->head_size = 0;
+	archive->file = IoOpen(archive->path, false);
+	if (archive->file)
+	{
+		STATS_SPAN span(stats, ARCHIVE_PHASE_HEADER);
+		IO_READER r;
+		IoReaderInit(&r, archive->file, 0, option.io_buffer_size);
+		archive->head_size = ReadHeader(r, option.password, archive->header, archive->dir, archive->extra);
+		IoReaderFree(&r);
+		StatsBytes(stats, ARCHIVE_PHASE_HEADER, archive->head_size, 0);
+	}
+	if (archive->head_size == 0)
+	{
+		CloseArchive(archive);
+		return nullptr;
+	}
+
+	// pXΐ̂̂g
+	archive->index.reserve(archive->dir.size());
+	for (size_t i = 0; i < archive->dir.size(); i++) archive->index.emplace(archive->dir.paths[i], i);
+	const auto& paths = archive->dir.paths;
+	archive->order.resize(archive->dir.size());
+	for (size_t i = 0; i < archive->order.size(); i++) archive->order[i] = i;
+	std::stable_sort(archive->order.begin(), archive->order.end(), [&](size_t a, size_t b) { return PathLess(paths[a], paths[b]); });
+	archive->order.erase(std::unique(archive->order.begin(), archive->order.end(), [&](size_t a, size_t b) { return PathEqual(paths[a], paths[b]); }), archive->order.end());
+	return archive;
+}
+
+ARCHIVE* OpenArchive(const ARCHIVE_OPTION& option, const std::string& path)
+{
+	STATS_SCOPE stats(option.stats, option.trace, "OpenArchive");
+	return OpenArchive(option, path, &stats);
+}
+
+void CloseArchive(ARCHIVE* archive)
+{
+	IoClose(archive->file);
+	delete archive;
+}
+
+// ׂẴGg̔ԍiA[JCu̒̈ʒȕj
+static std::vector<size_t> GetAllEntries(const ARCHIVE* archive)
+{
+	std::vector<size_t> entries(archive->dir.size());
+	for (size_t i = 0; i < entries.size(); i++) entries[i] = i;
+	return entries;
+}
+
+static std::vector<std::string_view> GetEntryPaths(const ARCHIVE* archive, const std::vector<size_t>& entries)
+{
+	std::vector<std::string_view> paths(entries.size());
+	for (size_t n = 0; n < entries.size(); n++) paths[n] = archive->dir.paths[entries[n]];
+	return paths;
+}
+
+// ňk̐ݒIԂƂɎݒƁAgqƂɎf[^̑傫i1̃t@CARCHIVE_SAMPLE_FILE܂Łj
+static const COMPRESS_SETTING level_candidates[] = {
+	{ 0, Z_DEFAULT_STRATEGY }, { 1, Z_DEFAULT_STRATEGY }, { 1, Z_RLE }, { 3, Z_DEFAULT_STRATEGY },
+	{ 6, Z_DEFAULT_STRATEGY }, { 6, Z_FILTERED }, { 9, Z_DEFAULT_STRATEGY },
+};
+constexpr size_t ARCHIVE_SAMPLE_SIZE = 1024 * 1024;
+constexpr size_t ARCHIVE_SAMPLE_FILE = 256 * 1024;
+// 菬{łzlib̏̎Ԃ唼ɂȂAk̑ĂɂȂȂ
+constexpr size_t ARCHIVE_SAMPLE_MIN = 64 * 1024;
+
+// ʂoption.level_goalɍ̂I
+static size_t ChooseTrial(const ARCHIVE_OPTION& option, const std::vector<COMPRESS_TRIAL>& trials, size_t sample_size)
+{
+	const double mb = sample_size / (1024.0 * 1024.0);
+	auto pack_speed = [&](size_t k) { return mb / std::max(trials[k].compress_seconds, 1e-9); };
+	auto decode_time = [&](size_t k) { return trials[k].uncompress_seconds + trials[k].pressed / (1024.0 * 1024.0) / option.read_speed; };
+	size_t best = 0;
+	for (size_t k = 1; k < trials.size(); k++)
+	{
+		// ς̍5%ɖȂΑ̗hƂ݂ȂAk̑̂I
+		if (option.level_goal == ARCHIVE_LEVEL_DECODE)
+		{
+			const double a = decode_time(k), b = decode_time(best);
+			if (a < b * 0.95 || (a < b * 1.05 && pack_speed(k) > pack_speed(best))) best = k;
+			continue;
+		}
+		// 𖞂̂΂̒ōł́AȂ΍ł́i{Α͌ɍł́j
+		if (sample_size < ARCHIVE_SAMPLE_MIN)
+		{
+			if (trials[k].pressed < trials[best].pressed) best = k;
+			continue;
+		}
+		const bool fast = pack_speed(k) >= option.min_pack_speed, best_fast = pack_speed(best) >= option.min_pack_speed;
+		if (fast != best_fast ? fast : fast ? trials[k].pressed < trials[best].pressed : pack_speed(k) > pack_speed(best)) best = k;
+	}
+	return best;
+}
+
+// GgƂ̈k̐ݒBoption.level_goalFIXEDłȂ΁AgqƂɃt@C̐擪W߂ĎđIсA
+// I񂾌ʂoption.level_choicesɓ
+static std::vector<COMPRESS_SETTING> ChooseLevels(const ARCHIVE_OPTION& option, const std::filesystem::path& base, const std::vector<std::string>& paths, int level, STATS_SCOPE* stats)
 {
-	const bool is_directory = std::filesystem::is_directory(path);
-	const auto cd = std::filesystem::current_path();
-	size_t pos = path.find_last_of('\\');
+	std::vector<COMPRESS_SETTING> settings(paths.size(), { level, Z_DEFAULT_STRATEGY });
+	if (option.level_goal == ARCHIVE_LEVEL_FIXED) return settings;
 
-	if (is_directory) {
-		std::filesystem::current_path(path);
-		std::filesystem::current_path("..");
+	std::map<std::string, std::vector<size_t>> types;
+	for (size_t i = 0; i < paths.size(); i++)
+	{
+		std::string type = std::filesystem::path(paths[i]).extension().string();
+		for (char& c : type) c = (char)std::tolower((unsigned char)c);
+		types[type].push_back(i);
 	}
-	else if (std::filesystem::exists(path)) {
-		if (pos != std::string::npos) std::filesystem::current_path(path.substr(0, pos));
+
+	STATS_SPAN span(stats, ARCHIVE_PHASE_SCAN);
+	const std::vector<COMPRESS_SETTING> candidates(std::begin(level_candidates), std::end(level_candidates));
+	if (option.level_choices) option.level_choices->clear();
+	for (const auto& type : types)
+	{
+		std::vector<uint8_t> sample;
+		for (size_t n = 0; n < type.second.size() && sample.size() < ARCHIVE_SAMPLE_SIZE; n++)
+		{
+			IO_FILE* in = IoOpen(base / paths[type.second[n]], false);
+			if (!in) continue;
+			const size_t len = (size_t)std::min<uint64_t>(IoSize(in), std::min(ARCHIVE_SAMPLE_FILE, ARCHIVE_SAMPLE_SIZE - sample.size()));
+			sample.resize(sample.size() + len);
+			if (!IoRead(in, sample.data() + sample.size() - len, len, 0)) sample.resize(sample.size() - len);
+			IoClose(in);
+		}
+		StatsBytes(stats, ARCHIVE_PHASE_SCAN, sample.size(), 0);
+
+		ARCHIVE_LEVEL_CHOICE choice = { type.first, type.second.size(), level, Z_DEFAULT_STRATEGY, 1, 0, 0 };
+		const std::vector<COMPRESS_TRIAL> trials = sample.empty() ? std::vector<COMPRESS_TRIAL>() : CompressTrial(sample.data(), sample.size(), candidates);
+		if (!trials.empty())
+		{
+			const COMPRESS_TRIAL& t = trials[ChooseTrial(option, trials, sample.size())];
+			const double mb = sample.size() / (1024.0 * 1024.0);
+			choice.level = t.setting.level;
+			choice.strategy = t.setting.strategy;
+			choice.ratio = (double)t.pressed / sample.size();
+			choice.pack_speed = mb / std::max(t.compress_seconds, 1e-9);
+			choice.unpack_speed = mb / std::max(t.uncompress_seconds, 1e-9);
+		}
+		for (size_t i : type.second) settings[i] = { choice.level, choice.strategy };
+		if (option.level_choices) option.level_choices->push_back(choice);
 	}
-	else return false;
+	return settings;
+}
+
+// WJ̑傫̍v
+static uint64_t GetTotalSize(const ARCHIVE* archive, const std::vector<size_t>& entries)
+{
+	uint64_t total = 0;
+	for (size_t i : entries) total += archive->dir.original_size[i];
+	return total;
+}
 
-	if (pos != std::string::npos) path = path.substr(pos + 1);
+bool EncodeArchive(const ARCHIVE_OPTION& option, std::string path, int _compress_level, bool _encrypt)
+{
+	STATS_SCOPE stats(option.stats, option.trace, "EncodeArchive");
+	ARCHIVE_NOTIFY notify(option);
+	const std::filesystem::path target = ResolvePath(option, path);
+	const bool is_directory = std::filesystem::is_directory(target);
+	if (!is_directory && !std::filesystem::exists(target)) return false;
 
+	// fBNgȂ炻̒̑΃pXAt@CȂt@CGg̃pXɂ
 	std::vector<std::string> paths;
-	if (is_directory) GetFileList(path, paths);
-	else paths.insert(paths.end(), path);
-	if (paths.size() == 0) return false;
+	std::vector<size_t> sizes;
+	uint64_t total = 0;
+	{
+		STATS_SPAN span(&stats, ARCHIVE_PHASE_SCAN);
+		if (is_directory) {
+			GetFileList(target.string(), paths);
+			for (auto& t : paths) t = std::filesystem::path(t).lexically_relative(target).string();
+		}
+		else paths.insert(paths.end(), target.filename().string());
 
-	if (is_directory) {
-		std::filesystem::current_path(path);
-		for (auto& t : paths) t = t.substr(path.size() + 1);
+		// wb_̑傫Ɍ߂āAGgł̂珑o߂ɑ傫ɒׂ
+		std::error_code ec;
+		sizes.resize(paths.size());
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			sizes[i] = (size_t)std::filesystem::file_size(is_directory ? target / paths[i] : target, ec);
+			if (ec) return false;
+			total += sizes[i];
+		}
 	}
+	if (paths.size() == 0) return false;
+	const std::filesystem::path base = is_directory ? target : target.parent_path();
+	const std::vector<COMPRESS_SETTING> settings = ChooseLevels(option, base, paths, _compress_level, &stats);
+	notify.Begin(paths.size(), total);
 
 	std::vector<FILE_HEADER> heads;
 	heads.resize(paths.size());
-	std::vector<uint8_t> data;
+	ARCHIVE_HEADER header = { paths.size(), GetPassMD(option.password), _encrypt ? option.cipher : ARCHIVE_CIPHER_NONE, 0 };
+	ARCHIVE_EXTRA extra;
+	std::random_device seed;
+	extra.salt = (uint64_t)seed() << 32 | seed();
+	extra.restarts.resize(paths.size());
+	if (header.cipher == ARCHIVE_CIPHER_GCM) extra.tags.resize(AES_BLOCK_BYTES * paths.size());
+	if (option.checksum == ARCHIVE_CHECKSUM_CRC32C) header.flags |= ARCHIVE_FLAG_CRC32C;
+	if (option.checksum == ARCHIVE_CHECKSUM_SHA3) header.flags |= ARCHIVE_FLAG_SHA3;
+	if (option.level_goal == ARCHIVE_LEVEL_FIXED && _compress_level == 0 && header.cipher == ARCHIVE_CIPHER_NONE) header.flags |= ARCHIVE_FLAG_RAW;
+	if (is_directory) header.flags |= ARCHIVE_FLAG_DIRECTORY;
+	extra.checksums.resize(GetChecksumSize(header) * paths.size());
+
+	// restarts͓̐͂̑傫Ō܂̂ŁAkOɃwb_̑傫킩
+	size_t restart_total = 0;
+	if (!(header.flags & ARCHIVE_FLAG_RAW))
+		for (size_t size : sizes) restart_total += GetRestartCount(size);
+	if (restart_total) header.flags |= ARCHIVE_FLAG_RESTART;
+	const size_t head_size = GetHeaderSize(header, paths, restart_total);
+
+	// Gg͂ł̂head_sizěɏɏoAwb_͍Ōɐ擪֏
+	const std::filesystem::path out_path = target.parent_path() / (target.filename().string() + option.extension);
+	IO_FILE* out = IoOpen(out_path, true, option.direct_io);
+	if (!out) return false;
+	IO_WRITER w;
+	IoWriterInit(&w, out, head_size, option.io_buffer_size);
+	auto fail = [&]() {
+		IoWriterFinish(&w);
+		IoClose(out);
+		std::error_code ec;
+		std::filesystem::remove(out_path, ec);
+		return false;
+	};
+
+	// directŏƂ́Awb_̏IƓIO_ALIGÑubNɓGg̐擪ĂAwb_ƈꏏɏ
+	const size_t boundary_size = (head_size + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN - head_size;
+	std::vector<uint8_t> boundary;
+	size_t data_size = 0;
+
+	const std::vector<uint8_t> hashes = GetEntryHashes(option.password, std::vector<std::string_view>(paths.begin(), paths.end()), &stats);
 	for (size_t i = 0; i < paths.size(); i++)
 	{
-		heads[i].pointer = data.size();
+		heads[i].pointer = data_size;
 		heads[i].path_size = paths[i].size();
-		heads[i].pressed_size = heads[i].original_size = (size_t)std::filesystem::file_size(paths[i]);
-		std::ifstream ifs;
-		ifs.open(paths[i], std::ios_base::in | std::ios_base::binary);
-		if (!ifs) return false;
-
-		uint8_t* original = new uint8_t[heads[i].original_size];
-		uint8_t* encoded;
-		ifs.read((char*)original, heads[i].original_size);
-
-		uint8_t hash[48], pass[48];
-		SHA3_384((uint8_t*)paths[i].c_str(), paths[i].size(), hash);
-		SHA3_384((uint8_t*)password.c_str(), password.size(), pass);
-		for (int i = 0; i < 48; i++) hash[i] ^= pass[i];
-
-		AesCtx ctx;
-		AesInitKey(&ctx, hash, 32);
-
-		heads[i].pressed_size = heads[i].original_size / 7 * 8 + 1024;
-		encoded = new uint8_t[heads[i].pressed_size];
-		compress2(encoded, (uLongf*)&heads[i].pressed_size, original, (uLongf)heads[i].original_size, _compress_level);
-		if (_encrypt) heads[i].pressed_size = AesEncryptCbc(&ctx, hash + 32, encoded, heads[i].pressed_size);
-
-		data.resize(data.size() + heads[i].pressed_size);
-		std::memcpy(data.data() + data.size() - heads[i].pressed_size, encoded, heads[i].pressed_size);
-
-		delete[] original; delete[] encoded;
-		ifs.close();
-
-		std::cout << paths[i] << std::endl;
-		std::cout << "oroginal size: " << heads[i].original_size << " Byte" << std::endl;
-		std::cout << "compressed size: " << heads[i].pressed_size << " Byte" << std::endl;
-		std::cout << "compression ratio: " << (float)heads[i].pressed_size / (float)heads[i].original_size * 100.0f << " %" << std::endl;
-		std::cout << std::endl;
-	}
+		notify.EntryBegin(paths[i]);
+
+		// xǂ܂Ȃ̂ŁAڏoƂ͓ǂݏI͂y[WLbVǂo
+		POOL_BUFFER original, encoded;
+		{
+			STATS_SPAN span(&stats, ARCHIVE_PHASE_READ);
+			IO_FILE* in = IoOpen(base / paths[i], false);
+			if (!in) return fail();
+			heads[i].pressed_size = heads[i].original_size = sizes[i];
+			original = AllocBuffer(&stats, heads[i].original_size);
+			IoAdvise(in, 0, 0, IO_ADVICE_SEQUENTIAL);
+			// ׂƂő傫ςĂ΁Awb_̑傫ȂȂ̂Ŏsɂ
+			const bool read = IoSize(in) == sizes[i] && IoRead(in, original.data, heads[i].original_size, 0);
+			if (option.direct_io) IoAdvise(in, 0, 0, IO_ADVICE_DONTNEED);
+			IoClose(in);
+			if (!read) return fail();
+			StatsBytes(&stats, ARCHIVE_PHASE_READ, heads[i].original_size, 0);
+		}
+		if (!extra.checksums.empty()) GetChecksum(header, original.data, heads[i].original_size, &extra.checksums[GetChecksumSize(header) * i], &stats);
+
+		// kňÍȂƂ͂̂܂܊i[AWJƂɃJ[l̒ŃRs[ł悤ɂ
+		if (!(header.flags & ARCHIVE_FLAG_RAW))
+		{
+			AesCtx ctx;
+			AesStream stream;
+			uint8_t iv[AES_BLOCK_BYTES];
+			size_t done = 0;
+			GetEntryKey(&hashes[48 * i], header, extra, ctx, iv);
 
-	ARCHIVE_HEADER header = { paths.size(), GetPassMD(), is_directory, _encrypt };
+			// kubNoтɁAm肵16oCgPʂŃLbVɂ邤ɈÍ
+			COMPRESS_SINK sink = nullptr;
+			if (header.cipher != ARCHIVE_CIPHER_NONE)
+			{
+				AesStreamInit(&stream, &ctx, header.cipher, false, iv);
+				sink = [&](uint8_t* dest, size_t size) {
+					const size_t end = size / AES_BLOCK_BYTES * AES_BLOCK_BYTES;
+					STATS_SPAN span(&stats, ARCHIVE_PHASE_CRYPT, end - done, end - done);
+					AesStreamUpdate(&stream, dest + done, dest + done, end - done);
+					done = end;
+				};
+			}
 
-	if (is_directory) std::filesystem::current_path("..");
+			heads[i].pressed_size = heads[i].original_size / 7 * 8 + 1024;
+			encoded = AllocBuffer(&stats, heads[i].pressed_size + AES_BLOCK_BYTES);
+			{
+				STATS_SPAN span(&stats, ARCHIVE_PHASE_COMPRESS, heads[i].original_size);
+				CompressParallel(encoded.data, &heads[i].pressed_size, original.data, heads[i].original_size, settings[i].level, &extra.restarts[i], 0, sink, settings[i].strategy, &stats);
+				StatsBytes(&stats, ARCHIVE_PHASE_COMPRESS, 0, heads[i].pressed_size);
+			}
+			if (header.cipher != ARCHIVE_CIPHER_NONE)
+			{
+				STATS_SPAN span(&stats, ARCHIVE_PHASE_CRYPT, heads[i].pressed_size - done);
+				heads[i].pressed_size = done + AesStreamFinish(&stream, encoded.data + done, heads[i].pressed_size - done);
+				StatsBytes(&stats, ARCHIVE_PHASE_CRYPT, 0, heads[i].pressed_size - done);
+			}
+			if (header.cipher == ARCHIVE_CIPHER_GCM) AesStreamTag(&stream, &extra.tags[AES_BLOCK_BYTES * i]);
+			if (extra.restarts[i].size() != GetRestartCount(sizes[i])) return fail();
+		}
 
-	std::ofstream ofs;
-	path += extension;
-	ofs.open(path, std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
-	if (!ofs) return false;
-	WriteHeader(ofs, header, heads, paths);
-	ofs.write((char*)data.data(), data.size());
-	ofs.close();
+		// Í܂ōς񂾏o͂̂܂܏oidirectłȂ΁Abuffer傫ȃGg̓Rs[ɏj
+		{
+			const uint8_t* entry = encoded.data ? encoded.data : original.data;
+			STATS_SPAN span(&stats, ARCHIVE_PHASE_WRITE, 0, heads[i].pressed_size);
+			if (boundary.size() < boundary_size)
+				boundary.insert(boundary.end(), entry, entry + std::min(heads[i].pressed_size, boundary_size - boundary.size()));
+			if (!IoWriterWrite(&w, entry, heads[i].pressed_size)) return fail();
+			data_size += heads[i].pressed_size;
+		}
+		notify.EntryEnd(paths[i], heads[i].original_size, heads[i].pressed_size, true);
+	}
+	if (!IoWriterFinish(&w)) return notify.End(fail());
 
-	std::filesystem::current_path(cd);
-	return true;
+	IoWriterInit(&w, out, 0, option.io_buffer_size);
+	{
+		STATS_SPAN span(&stats, ARCHIVE_PHASE_HEADER);
+		WriteHeader(w, header, heads, paths, extra);
+		StatsBytes(&stats, ARCHIVE_PHASE_HEADER, 0, w.offset + w.len);
+	}
+	bool result = w.offset + w.len == head_size;
+	if (IoIsDirect(out)) IoWriterWrite(&w, boundary.data(), boundary.size());
+	result = IoWriterFinish(&w) && result;
+	if (!result) return notify.End(fail());
+	IoClose(out);
+	return notify.End(true);
 }
 
-bool CheckArchive(std::string path)
+bool CheckArchive(const ARCHIVE_OPTION& option, std::string path)
 {
-	std::ifstream ifs;
-	ifs.open(path, std::ios_base::in | std::ios_base::binary);
-	if (!ifs) return false;
-
-	std::vector<FILE_HEADER> head;
-	std::vector<std::string> paths;
-	ARCHIVE_HEADER header;
-	size_t head_size = ReadHeader(ifs, header, head, paths);
-	if (head_size == 0) return false;
+	STATS_SCOPE stats(option.stats, option.trace, "CheckArchive");
+	ARCHIVE* archive = OpenArchive(option, path, &stats);
+	if (!archive) return false;
+	const ARCHIVE_DIRECTORY& dir = archive->dir;
 
 	std::string first_dir;
 	size_t pos = path.find_first_of('\\');
-	if (header.is_directory && pos != std::string::npos) first_dir = path.substr(0, pos + 1);	
+	if ((archive->header.flags & ARCHIVE_FLAG_DIRECTORY) && pos != std::string::npos) first_dir = path.substr(0, pos + 1);
 
-	for (size_t i = 0; i < head.size(); i++)
+	for (size_t i = 0; i < dir.size(); i++)
 	{
-		std::cout << first_dir + paths[i] << std::endl;
-		std::cout << "oroginal size: " << head[i].original_size << " Byte" << std::endl;
-		std::cout << "compressed size: " << head[i].pressed_size << " Byte" << std::endl;
-		std::cout << "compression ratio: " << (float)head[i].pressed_size / (float)head[i].original_size * 100.0f << " %" << std::endl;
-		std::cout << "pointer: " << head_size + head[i].pointer << std::endl;
+		std::cout << first_dir << dir.paths[i] << std::endl;
+		std::cout << "oroginal size: " << dir.original_size[i] << " Byte" << std::endl;
+		std::cout << "compressed size: " << dir.pressed_size[i] << " Byte" << std::endl;
+		std::cout << "compression ratio: " << (float)dir.pressed_size[i] / (float)dir.original_size[i] * 100.0f << " %" << std::endl;
+		std::cout << "pointer: " << archive->head_size + dir.pointer[i] << std::endl;
 		std::cout << std::endl;
 	}
 
-	ifs.close();
+	CloseArchive(archive);
 	return true;
 }
 
-size_t GetDataFromArchive(std::string path, void* dest, std::string archive_path)
+bool VerifyArchive(const ARCHIVE_OPTION& option, std::string path)
 {
-	size_t pos = path.find_first_of('\\');
-	if (pos != std::string::npos) archive_path = path.substr(0, pos) + extension;	
-	else if (archive_path.empty()) archive_path = path + extension;
+	STATS_SCOPE stats(option.stats, option.trace, "VerifyArchive");
+	ARCHIVE_NOTIFY notify(option);
+	ARCHIVE* archive = OpenArchive(option, path, &stats);
+	if (!archive) return false;
+	const std::vector<size_t> entries = GetAllEntries(archive);
+	notify.Begin(entries.size(), GetTotalSize(archive, entries));
 
-	std::ifstream ifs;
-	ifs.open(archive_path, std::ios_base::in | std::ios_base::binary);
-	if (!ifs) return 0;
-	std::vector<FILE_HEADER> head;
-	std::vector<std::string> paths;
-	ARCHIVE_HEADER header;
-	size_t head_size = ReadHeader(ifs, header, head, paths);
-	if (head_size == 0) return false;
+	const std::vector<uint8_t> hashes = GetEntryHashes(archive->password, archive->dir.paths, &stats);
+	std::vector<uint8_t> ok;
+	IoAdvise(archive->file, 0, 0, IO_ADVICE_SEQUENTIAL);
+	const bool result = ExtractEntries(archive, entries, hashes, nullptr, ok, &stats, notify);
+	CloseArchive(archive);
+	return notify.End(result);
+}
 
-	std::string first_dir;
-	if (header.is_directory) first_dir = path.substr(0, pos + 1);
+// indexԖڂ̃GgWJdestɏށBdestnullptrȂTCYԂ
+static size_t GetEntryData(const ARCHIVE* archive, size_t index, void* dest)
+{
+	const size_t size = archive->dir.original_size[index];
+	if (!dest) return size;
 
-	size_t size = 0;
-	for (size_t i = 0; i < head.size(); i++)
-	{
-		if (path == first_dir + paths[i])
-		{
-			size = head[i].original_size;
-			if (!dest) return size;
+	STATS_SCOPE stats(archive->stats, archive->trace, "GetDataFromArchive");
+	const std::vector<uint8_t> hash = GetEntryHashes(archive->password, { archive->dir.paths[index] }, &stats);
+	return ReadEntry(archive, index, hash.data(), (uint8_t*)dest, &stats) ? size : 0;
+}
 
-			ifs.seekg((uint64_t)head_size + head[i].pointer, std::ios_base::beg);
-			uint8_t* pressed = new uint8_t[head[i].pressed_size];
-			uint8_t* original = new uint8_t[head[i].original_size + 1024];
-			ifs.read((char*)pressed, head[i].pressed_size);
+size_t GetDataFromArchive(const ARCHIVE* archive, const std::string& path, void* dest)
+{
+	const auto it = archive->index.find(path);
+	if (it == archive->index.end()) return 0;
+	return GetEntryData(archive, it->second, dest);
+}
 
-			uint8_t hash[48], pass[48];
-			SHA3_384((uint8_t*)paths[i].c_str(), paths[i].size(), hash);
-			SHA3_384((uint8_t*)password.c_str(), password.size(), pass);
-			for (int i = 0; i < 48; i++) hash[i] ^= pass[i];
+ARCHIVE_MOUNT* CreateArchiveMount()
+{
+	return new ARCHIVE_MOUNT;
+}
 
-			AesCtx ctx;
-			AesInitKey(&ctx, hash, 32);
-			if (header.is_encrypted) head[i].pressed_size = AesDecryptCbc(&ctx, hash + 32, pressed, head[i].pressed_size);
-			uncompress(original, (uLongf*)&head[i].original_size, pressed, (uLongf)head[i].pressed_size);
+void DestroyArchiveMount(ARCHIVE_MOUNT* mount)
+{
+	for (ARCHIVE* archive : mount->archives) CloseArchive(archive);
+	delete mount;
+}
 
-			memcpy(dest, original, head[i].original_size);
-			delete[] pressed; delete[] original;
-			break;
-		}
-	}
+bool MountArchive(ARCHIVE_MOUNT* mount, const ARCHIVE_OPTION& option, const std::string& path)
+{
+	ARCHIVE* archive = OpenArchive(option, path);
+	if (!archive) return false;
 
-	ifs.close();
-	return size;
+	const size_t number = mount->archives.size();
+	mount->archives.push_back(archive);
+	mount->index.reserve(mount->index.size() + archive->index.size());
+	for (const auto& entry : archive->index) mount->index[entry.first] = { number, entry.second };
+	return true;
 }
 
-bool DecodeArchive(std::string path)
+bool GetFileList(const ARCHIVE_MOUNT* mount, std::vector<std::string>& list)
 {
-	const auto cd = std::filesystem::current_path();
-	size_t pos = path.find_last_of('\\');
-	if (pos != std::string::npos) {
-		std::filesystem::current_path(path.substr(0, pos));
-		path = path.substr(pos + 1);
-	}
+	for (const auto& entry : mount->index) list.insert(list.end(), std::string(entry.first));
+	return true;
+}
+
+size_t GetDataFromMount(const ARCHIVE_MOUNT* mount, const std::string& path, void* dest)
+{
+	const auto it = mount->index.find(path);
+	if (it == mount->index.end()) return 0;
+	return GetEntryData(mount->archives[it->second.first], it->second.second, dest);
+}
 
-	std::ifstream ifs;
-	ifs.open(path, std::ios_base::in | std::ios_base::binary);
-	if (!ifs) return false;
+size_t GetDataFromArchive(const ARCHIVE_OPTION& option, std::string path, void* dest, std::string archive_path)
+{
+	size_t pos = path.find_first_of("\\/");
+	if (pos != std::string::npos) archive_path = path.substr(0, pos) + option.extension;
+	else if (archive_path.empty()) archive_path = path + option.extension;
+
+	ARCHIVE* archive = OpenArchive(option, archive_path);
+	if (!archive) return 0;
 
-	std::vector<FILE_HEADER> head;
-	std::vector<std::string> paths;
-	ARCHIVE_HEADER header;
-	size_t head_size = ReadHeader(ifs, header, head, paths);
-	if (head_size == 0) return false;
 	std::string first_dir;
-	if (header.is_directory) 
+	if ((archive->header.flags & ARCHIVE_FLAG_DIRECTORY)) first_dir = path.substr(0, pos + 1);
+
+	size_t size = 0;
+	if (PathEqual(std::string_view(path).substr(0, first_dir.size()), first_dir)) size = GetDataFromArchive(archive, path.substr(first_dir.size()), dest);
+	CloseArchive(archive);
+	return size;
+}
+
+// patternnullptrȂ炷ׂẴGgAłȂΈvGgA[JCu̒̈ʒȕɓWJ
+static bool DecodeArchive(const ARCHIVE_OPTION& option, const std::string& path, const std::string* pattern)
+{
+	STATS_SCOPE stats(option.stats, option.trace, "DecodeArchive");
+	ARCHIVE_NOTIFY notify(option);
+	ARCHIVE* archive = OpenArchive(option, path, &stats);
+	if (!archive) return false;
+	std::vector<size_t> entries = pattern ? FindEntries(archive, *pattern) : GetAllEntries(archive);
+	if (pattern) std::sort(entries.begin(), entries.end(), [&](size_t a, size_t b) { return archive->dir.pointer[a] < archive->dir.pointer[b]; });
+	notify.Begin(entries.size(), GetTotalSize(archive, entries));
+	if (entries.empty())
 	{
-		first_dir = path.substr(0, path.size() - extension.size()) + "\\";
-		for (auto& p : paths) p = first_dir + p;
+		CloseArchive(archive);
+		return notify.End(false);
 	}
 
-	ifs.close();
-
-	for (size_t i = 0; i < head.size(); i++)
+	// fBNgkA[JCúAgqÕfBNg̒ɓWJ
+	std::filesystem::path first_dir;
+	if ((archive->header.flags & ARCHIVE_FLAG_DIRECTORY))
 	{
-		uint8_t* original = new uint8_t[head[i].original_size];
-		if (header.is_directory) GetDataFromArchive(paths[i], original);
-		else GetDataFromArchive(paths[i], original, path);
+		const std::string name = archive->path.filename().string();
+		first_dir = name.substr(0, name.size() - std::min(name.size(), option.extension.size()));
+	}
 
-		std::cout << paths[i] << std::endl;
-		std::cout << "size: " << head[i].original_size << " Byte" << std::endl;
-		std::cout << std::endl;
+	const std::vector<uint8_t> hashes = GetEntryHashes(archive->password, GetEntryPaths(archive, entries), &stats);
+	std::vector<uint8_t> ok;
+	IoAdvise(archive->file, 0, 0, IO_ADVICE_SEQUENTIAL);
+	const bool result = ExtractEntries(archive, entries, hashes, &first_dir, ok, &stats, notify);
+	CloseArchive(archive);
+	return notify.End(result);
+}
 
-		size_t pos = paths[i].find_last_of('\\');
-		if (pos != std::string::npos) {	
-			std::string dir = paths[i].substr(0, pos);			
-			if (!std::filesystem::exists(dir)) std::filesystem::create_directories(dir);
-		}
+bool DecodeArchive(const ARCHIVE_OPTION& option, std::string path)
+{
+	return DecodeArchive(option, path, nullptr);
+}
 
-		std::ofstream ofs;
-		ofs.open(paths[i], std::ios_base::out | std::ios_base::trunc | std::ios_base::binary);
-		if (!ofs) return false;
-		ofs.write((char*)original, head[i].original_size);
-		ofs.close();
+bool DecodeArchive(const ARCHIVE_OPTION& option, std::string path, const std::string& pattern)
+{
+	return DecodeArchive(option, path, &pattern);
+}
 
-		delete[] original;
-	}
+bool EncodeArchive(std::string path, int _compress_level, bool _encrypt)
+{
+	return EncodeArchive(default_option, path, _compress_level, _encrypt);
+}
 
-	std::filesystem::current_path(cd);
-	return true;
+bool DecodeArchive(std::string path)
+{
+	return DecodeArchive(default_option, path);
+}
+
+bool DecodeArchive(std::string path, const std::string& pattern)
+{
+	return DecodeArchive(default_option, path, pattern);
+}
+
+bool CheckArchive(std::string path)
+{
+	return CheckArchive(default_option, path);
+}
+
+bool VerifyArchive(std::string path)
+{
+	return VerifyArchive(default_option, path);
+}
+
+size_t GetDataFromArchive(std::string path, void* dest, std::string archive_path)
+{
+	return GetDataFromArchive(default_option, path, dest, archive_path);
 }
\ No newline at end of file
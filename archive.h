@@ -7,19 +7,205 @@
 #pragma comment(lib, "MT\\zlibstatic.lib")
 #endif
 
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Íp[hBCTR̓pfBOsvŁAubNƂɕňÍEłB
+// GCMCTRɃGgƂ16oCg̔F؃^OAƓɉjoB
+enum ARCHIVE_CIPHER : uint8_t {
+	ARCHIVE_CIPHER_NONE,
+	ARCHIVE_CIPHER_CBC,
+	ARCHIVE_CIPHER_CTR,
+	ARCHIVE_CIPHER_GCM,
+};
+
+// WJ̃f[^̃`FbNTBCRC32CSSE4.2Ȃǂ̖߂ΑASHA3͈Ӑ}IȉɂB
+enum ARCHIVE_CHECKSUM : uint8_t {
+	ARCHIVE_CHECKSUM_NONE,
+	ARCHIVE_CHECKSUM_CRC32C,
+	ARCHIVE_CHECKSUM_SHA3,
+};
+
+// EncodeArchiveňk̐ݒIԕ@BFIXEDȊO͊gqƂɃt@C̐擪̃xƕňkĂ݂đIԁB
+enum ARCHIVE_LEVEL_GOAL : uint8_t {
+	ARCHIVE_LEVEL_FIXED,	// ̃xׂẴGgɎg
+	ARCHIVE_LEVEL_RATIO,	// k̑min_pack_speedȏ̂ōłȂ́iȂ΍ł́B{64KBɖȂΑ͌Ȃj
+	ARCHIVE_LEVEL_DECODE,	// WJ̎ԁiread_speedňk̃f[^ǂގԂ܂ށjłZ
+};
+
+// gqƂɑI񂾐ݒƁAƂ̌ʁB1XbhłMB/s
+struct ARCHIVE_LEVEL_CHOICE {
+	std::string type;	// ɂgqiȂ΋j
+	size_t files;
+	int level, strategy;
+	double ratio;	// k/kO
+	double pack_speed, unpack_speed;
+};
+
+// ̒iKBARCHIVE_STATSŒiKƂɎԂƗʂ𐔂
+enum ARCHIVE_PHASE : uint8_t {
+	ARCHIVE_PHASE_SCAN,	// kt@C̗񋓂ƁAk̐ݒIԂ߂̎
+	ARCHIVE_PHASE_HEADER,	// wb_̓ǂݏ
+	ARCHIVE_PHASE_KEY,	// SHA3ɂGǧ̓o
+	ARCHIVE_PHASE_READ,	// t@C̓ǂݍ݁i܂Ƃ߂Ĕŝ͊҂ԂWAITɐj
+	ARCHIVE_PHASE_CHECKSUM,
+	ARCHIVE_PHASE_COMPRESS,	// deflateinflate
+	ARCHIVE_PHASE_CRYPT,	// AES̈Íƕ
+	ARCHIVE_PHASE_WRITE,
+	ARCHIVE_PHASE_WAIT,	// ܂Ƃ߂Ĕsǂݏ̊҂
+	ARCHIVE_PHASE_NUM,
+};
+
+// Ԃ͕bBiKƂ̎Ԃ́Aق̒iK܂܂ȂXbhƂ̎Ԃ̍vȂ̂ŁAɏƑŜ蒷Ȃ邱ƂB
+// ɈkEWJƂ́AubNԂƂɂXbhŐicalls̐j
+struct ARCHIVE_PHASE_STATS {
+	double wall = 0, cpu = 0;
+	uint64_t bytes_in = 0, bytes_out = 0;
+	uint64_t calls = 0;
+};
+
+// ARCHIVE_OPTION::statsɓnƁAĂяoI邽тɉZîʁX̃XbhnĂ悢j
+struct ARCHIVE_STATS {
+	ARCHIVE_PHASE_STATS phases[ARCHIVE_PHASE_NUM];
+	double wall = 0, cpu = 0;	// ĂяoɂԂƃvZXŜCPU
+	uint64_t bytes_in = 0, bytes_out = 0;	// t@Cǂ񂾗ʂƏ
+	uint64_t allocations = 0;	// Gg̍Ɨpobt@mۂ
+	uint64_t peak_buffer = 0;	// xɊmۂő̃obt@̃oCg
+	uint64_t calls = 0;
+};
+
+enum ARCHIVE_EVENT_TYPE : uint8_t {
+	ARCHIVE_EVENT_BEGIN,	// n߂Bfiles_totalbytes_total܂Ă
+	ARCHIVE_EVENT_ENTRY_BEGIN,	// Gg̏n߂
+	ARCHIVE_EVENT_ENTRY_END,	// Gg̏IBokUȂ炻̃Gg͉Ă邩ǂ߂Ȃ
+	ARCHIVE_EVENT_END,	// IBok͊֐̖߂lƓ
+};
+
+// i݋͓WJ̑傫Ő
+struct ARCHIVE_EVENT {
+	ARCHIVE_EVENT_TYPE type;
+	std::string_view path;	// Gg̃pXiENTRY_BEGINENTRY_END̂݁j
+	uint64_t original_size, pressed_size;	// Gg̑傫iENTRY_END̂݁j
+	bool ok;
+	size_t files_done, files_total;
+	uint64_t bytes_done, bytes_total;
+	uint64_t pressed_done;	// IGg̈k̑傫̍v
+};
+
+// EncodeArchiveEDecodeArchiveEVerifyArchiveĂяoXbh珇ɌĂԁBuserARCHIVE_OPTION::callback_user̂܂ܓn
+typedef void (*ARCHIVE_CALLBACK)(const ARCHIVE_EVENT& event, void* user);
+
+// ̒iKXbhƂɎŋL^́BChrometrace event`JSONɏoA
+// Perfettochrome://tracingŌB̌ĂяoŋLĂ悢B
+// ɈkEWJubNԂ́AXbh̍sɋL^B
+struct ARCHIVE_TRACE;
+
+// ĂяoƂɓnݒB֐͂ƃA[JCũnhȊȌԂA
+// JgfBNgύXȂ̂ŁAʁX̃Xbh瓯ɌĂяoĂ悢B
+struct ARCHIVE_OPTION {
+	std::string password;
+	std::string extension = ".dat";
+	ARCHIVE_CIPHER cipher = ARCHIVE_CIPHER_CBC;	// EncodeArchiveňÍƂ̃[h
+	ARCHIVE_CHECKSUM checksum = ARCHIVE_CHECKSUM_CRC32C;	// EncodeArchiveŃGgƂɋL^`FbNT
+	std::string root;	// ΃pX̊ɂȂfBNgiȂJgfBNgj
+	size_t io_buffer_size = 1024 * 1024;	// wb_A[JCu܂Ƃ߂ēǂݏP
+	bool direct_io = false;	// EncodeArchiveŃy[WLbVʂɏoiO_DIRECTj
+	ARCHIVE_STATS* stats = nullptr;	// nƏ̓𐔂iOpenArchiveŊJA[JCu̓ǂݏo܂ށj
+	ARCHIVE_TRACE* trace = nullptr;	// nƏ̒iKL^istatsƓOpenArchiveŊJA[JCu̓ǂݏo܂ށj
+	ARCHIVE_CALLBACK callback = nullptr;	// i݋󂯎inullptrȂ牽\Ȃj
+	void* callback_user = nullptr;
+	ARCHIVE_LEVEL_GOAL level_goal = ARCHIVE_LEVEL_FIXED;	// EncodeArchiveňk̐ݒIԕ@
+	double min_pack_speed = 50;	// ARCHIVE_LEVEL_RATIOŋ߂1Xbḧk̑iMB/sj
+	double read_speed = 500;	// ARCHIVE_LEVEL_DECODEœǂݍ݂̎Ԃς鑬iMB/sj
+	std::vector<ARCHIVE_LEVEL_CHOICE>* level_choices = nullptr;	// nƎőI񂾐ݒ󂯎
+};
+
+// OpenArchiveŊJA[JCuBwb_xǂݍłÃXbh瓯ɓǂݏoB
+struct ARCHIVE;
+// ̃A[JCud˂1̃fBNgƂĈi{҂̏DLCpb`d˂ȂǁjB
+struct ARCHIVE_MOUNT;
+
+// ȉSet`ARCHIVE_OPTIONȂ֐̊̐ݒςiXbhZ[tł͂ȂjB
 void SetArchivePassword(const std::string& _pass);
 void SetArchiveExtension(const std::string& _extension);
+// EncodeArchiveňÍƂ̃[hiCBCjB[h̓A[JCũwb_ɋL^B
+void SetArchiveCipher(ARCHIVE_CIPHER _cipher);
+// EncodeArchiveŃGgƂɋL^`FbNTiCRC32CASHA3SHA3-256jB
+void SetArchiveChecksum(ARCHIVE_CHECKSUM _checksum);
+// ̓𐔂inullptrŐȂjB
+void SetArchiveStats(ARCHIVE_STATS* _stats);
+// iKƂ1s\
+void PrintArchiveStats(const ARCHIVE_STATS& stats, std::ostream& out = std::cout);
+// ̒iKL^inullptrŋL^ȂjB
+void SetArchiveTrace(ARCHIVE_TRACE* _trace);
+// L^̍쐬ƔjBL^͎CreateArchiveTracěoߎԂŎ
+ARCHIVE_TRACE* CreateArchiveTrace();
+void DestroyArchiveTrace(ARCHIVE_TRACE* trace);
+// L^Chrometrace event`JSONŏoBL^ĂĂяoIĂĂԂ
+bool WriteArchiveTrace(const ARCHIVE_TRACE* trace, const std::string& path);
+// i݋󂯎֐inullptrŉ\ȂjB
+void SetArchiveCallback(ARCHIVE_CALLBACK _callback, void* _user = nullptr);
+// EncodeArchiveňk̐ݒIԕ@iFIXEDň̃xgjB
+void SetArchiveLevelGoal(ARCHIVE_LEVEL_GOAL _goal, double _min_pack_speed = 50, double _read_speed = 500);
+// őI񂾐ݒ󂯎inullptrŎ󂯎ȂjB
+void SetArchiveLevelChoices(std::vector<ARCHIVE_LEVEL_CHOICE>* _choices);
+// I񂾐ݒgqƂ1s\
+void PrintArchiveLevelChoices(const std::vector<ARCHIVE_LEVEL_CHOICE>& choices, std::ostream& out = std::cout);
 
 bool EncodeArchive(std::string path, int _compress_level = Z_DEFAULT_COMPRESSION, bool _encrypt = true);
 bool DecodeArchive(std::string path);
+// patternɈvGgWJipatternMatchFileListƓjBvGgȂfalseԂB
+bool DecodeArchive(std::string path, const std::string& pattern);
 bool CheckArchive(std::string path);
+// ׂẴGgRÃXbhŕEWJA`FbNT^Om߂it@C͏oȂjB
+// GCM̃A[JCu̓^ȌƍŊm߁AWJȂB
+// ꂽGgokUARCHIVE_EVENT_ENTRY_ENDŒʒmB
+bool VerifyArchive(std::string path);
+
+// wb_̓ǉɎgXORisizeɂjBx`}[Nőx𑪂邽߂ɌJĂB
+void XorBits(char* bits, size_t size);
 
 // @t@C̃pXifBNgkꍇ̓A[JCut@C̊gqŏ̃fBNgƂȂj
 // @t@Cf[^󂯎obt@i炩ߊmۂ邱ƁjBNULLnullptrw肷΃f[^TCŶ݂ԂB
 // O@A[JCut@C̃pXifBNgkꍇ͖jA[JCut@C̊gqkt@CƓȂȗB
-// ߂l@@f[^TCYBpX[hԈt@C݂ȂƂ͂OԂB
-size_t GetDataFromArchive(std::string path, void* dest, std::string archive_path = "");
\ No newline at end of file
+// ߂l@@f[^TCYBpX[hԈt@C݂ȂƂAf[^ĂƂ͂OԂB
+size_t GetDataFromArchive(std::string path, void* dest, std::string archive_path = "");
+
+bool EncodeArchive(const ARCHIVE_OPTION& option, std::string path, int _compress_level = Z_DEFAULT_COMPRESSION, bool _encrypt = true);
+bool DecodeArchive(const ARCHIVE_OPTION& option, std::string path);
+bool DecodeArchive(const ARCHIVE_OPTION& option, std::string path, const std::string& pattern);
+bool CheckArchive(const ARCHIVE_OPTION& option, std::string path);
+bool VerifyArchive(const ARCHIVE_OPTION& option, std::string path);
+size_t GetDataFromArchive(const ARCHIVE_OPTION& option, std::string path, void* dest, std::string archive_path = "");
+
+// pX[hԈt@C݂ȂƂnullptrԂBCloseArchiveŕ邱ƁB
+ARCHIVE* OpenArchive(const ARCHIVE_OPTION& option, const std::string& path);
+void CloseArchive(ARCHIVE* archive);
+// A[JCuɓĂGg̃pXifBNgkꍇŏ̃fBNg͊܂܂ȂjlistɒǉB
+bool GetFileList(const ARCHIVE* archive, std::vector<std::string>& list);
+// ȉ̓pX̎̍ŒTA̂listɒǉBȂfalseԂB
+// ؂\/̂ǂŏĂ悭AA[JCuɋL^؂Ɠ̂ƂĔׂB
+// prefixŎn܂Gg̃pX
+bool GetFileList(const ARCHIVE* archive, const std::string& prefix, std::vector<std::string>& list);
+// fBNgdir̒ɂt@CƃfBNg̖OifBNg͖ɋ؂tjBdirȂŏʁB
+// dir̖̋؂͏ȂĂ悢B
+bool GetChildList(const ARCHIVE* archive, const std::string& dir, std::vector<std::string>& list);
+// patternɈvGg̃pXB*͋؂܂ȂCӂ̕A**͋؂܂Cӂ̕A?͋؂ȊO1B
+// Fmaps\level3\*maps\level3̒̃t@CAmaps\level3\**ׂ͂̉̂Ẵt@C
+bool MatchFileList(const ARCHIVE* archive, const std::string& pattern, std::vector<std::string>& list);
+// pathGetFileListœGg̃pXi؂\/̂ǂŏĂ悢jB߂lGetDataFromArchiveƓB
+size_t GetDataFromArchive(const ARCHIVE* archive, const std::string& path, void* dest);
+
+// }Eg̍쐬ƔjBDestroyArchiveMount̓}EgA[JCuׂĕB
+ARCHIVE_MOUNT* CreateArchiveMount();
+void DestroyArchiveMount(ARCHIVE_MOUNT* mount);
+// A[JCuJďd˂BpX̃Gg͌ォ}EĝD悳B
+// }EgI܂ł͑̃XbhǂݏoȂƁB
+bool MountArchive(ARCHIVE_MOUNT* mount, const ARCHIVE_OPTION& option, const std::string& path);
+// d˂ʂ̃Gg̃pXlistɒǉi͕sjB
+bool GetFileList(const ARCHIVE_MOUNT* mount, std::vector<std::string>& list);
+// pXx̃nbV\̌ŗD悳A[JCũGgɉēǂݏoB߂lGetDataFromArchiveƓB
+size_t GetDataFromMount(const ARCHIVE_MOUNT* mount, const std::string& path, void* dest);
\ No newline at end of file
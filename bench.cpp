@@ -0,0 +1,410 @@
+#include "bench.h"
+#include "archive.h"
+#include "checksum.h"
+#include "compress.h"
+#include "crypto.h"
+#include "parallel.h"
+#include "sha3.h"
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+// ʂ1sBvalues͖OƐl̑ĝ܂JSONɏo
+struct BENCH_RESULT {
+	std::string name;
+	std::vector<std::pair<std::string, double>> values;
+};
+
+// A[JCu̐ݒ
+struct BENCH_CONFIG {
+	const char* name;
+	ARCHIVE_CIPHER cipher;
+	int level;
+	bool encrypt;
+};
+
+static const BENCH_CONFIG bench_configs[] = {
+	{ "cbc-6", ARCHIVE_CIPHER_CBC, 6, true },
+	{ "ctr-1", ARCHIVE_CIPHER_CTR, 1, true },
+	{ "raw-0", ARCHIVE_CIPHER_NONE, 0, false },
+};
+
+static double Now()
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// prepareĂłfuncɂԂrepeat񑪂AZɕׂĕԂ
+template <class Prepare, class Func>
+static std::vector<double> Measure(unsigned repeat, Prepare prepare, Func func)
+{
+	std::vector<double> seconds;
+	for (unsigned i = 0; i < repeat; i++)
+	{
+		prepare();
+		const double start = Now();
+		func();
+		seconds.push_back(Now() - start);
+	}
+	std::sort(seconds.begin(), seconds.end());
+	return seconds;
+}
+
+template <class Func>
+static std::vector<double> Measure(unsigned repeat, Func func)
+{
+	return Measure(repeat, []() {}, func);
+}
+
+// ŒZƒl̎ԁAŒZ̎Ԃ狁߂xL^
+static void AddThroughput(std::vector<BENCH_RESULT>& results, const std::string& name, uint64_t bytes, size_t files, const std::vector<double>& seconds)
+{
+	const double best = seconds.front(), median = seconds[seconds.size() / 2];
+	const double mb = bytes / (1024.0 * 1024.0);
+	results.push_back({ name, {
+		{ "bytes", (double)bytes },
+		{ "files", (double)files },
+		{ "best_s", best },
+		{ "median_s", median },
+		{ "mb_per_s", best > 0 ? mb / best : 0.0 },
+	} });
+	std::cout << name << ": " << (best > 0 ? mb / best : 0.0) << " MB/s (best " << best << " s, median " << median << " s)" << std::endl;
+}
+
+// Pׂ͂̂悤ȃf[^ideflate悭j
+static void FillText(std::mt19937_64& rng, uint8_t* data, size_t size)
+{
+	static const char* const words[] = {
+		"archive", "entry", "header", "pointer", "size", "the", "of", "and", "to", "in", "level", "map",
+		"texture", "sound", "script", "player", "enemy", "item", "quest", "dialog", "=", "{", "}", ";",
+	};
+	size_t pos = 0;
+	while (pos < size)
+	{
+		const char* w = words[rng() % (sizeof(words) / sizeof(words[0]))];
+		for (; *w && pos < size; w++) data[pos++] = *w;
+		if (pos < size) data[pos++] = rng() % 12 ? ' ' : '\n';
+	}
+}
+
+static void FillRandom(std::mt19937_64& rng, uint8_t* data, size_t size)
+{
+	for (size_t i = 0; i < size; i += 8)
+	{
+		const uint64_t v = rng();
+		memcpy(data + i, &v, std::min<size_t>(8, size - i));
+	}
+}
+
+// _f[^̂悤ȏς鐔l̕сix͏kށj
+static void FillMesh(std::mt19937_64& rng, uint8_t* data, size_t size)
+{
+	float v = 0.0f;
+	for (size_t i = 0; i < size; i += sizeof(float))
+	{
+		v += (float)(rng() % 1000) / 1000.0f - 0.5f;
+		memcpy(data + i, &v, std::min(sizeof(float), size - i));
+	}
+}
+
+// ƂǂɃf[^AقƂ0̃f[^igp̗̈܂ރZ[uf[^Ȃǁj
+static void FillSparse(std::mt19937_64& rng, uint8_t* data, size_t size)
+{
+	memset(data, 0, size);
+	for (size_t i = 0; i < size; i += 256 * 1024)
+		FillRandom(rng, data + i, std::min<size_t>(4096, size - i));
+}
+
+static bool WriteFile(const std::filesystem::path& path, const std::vector<uint8_t>& data)
+{
+	std::filesystem::create_directories(path.parent_path());
+	std::ofstream ofs(path, std::ios::binary);
+	ofs.write((const char*)data.data(), data.size());
+	return (bool)ofs;
+}
+
+// f[^BnamecorpusfBNg̒̃fBNgi܂̓t@Cj̖O
+struct BENCH_CORPUS {
+	std::string name;
+	uint64_t bytes;
+	size_t files;
+};
+
+static BENCH_CORPUS MakeTiny(const std::filesystem::path& dir, double scale, std::mt19937_64& rng)
+{
+	BENCH_CORPUS corpus{ "tiny", 0, std::max<size_t>(1, (size_t)(20000 * scale)) };
+	std::vector<uint8_t> data;
+	for (size_t i = 0; i < corpus.files; i++)
+	{
+		data.resize(64 + rng() % 960);
+		FillText(rng, data.data(), data.size());
+		if (!WriteFile(dir / corpus.name / ("dir" + std::to_string(i % 100)) / ("text" + std::to_string(i) + ".txt"), data)) return {};
+		corpus.bytes += data.size();
+	}
+	return corpus;
+}
+
+static BENCH_CORPUS MakeMixed(const std::filesystem::path& dir, double scale, std::mt19937_64& rng)
+{
+	BENCH_CORPUS corpus{ "mixed", 0, std::max<size_t>(4, (size_t)(400 * scale)) };
+	static const char* const kinds[] = { "script", "texture", "mesh", "save" };
+	std::vector<uint8_t> data;
+	for (size_t i = 0; i < corpus.files; i++)
+	{
+		const size_t kind = i % 4;
+		data.resize((size_t)4096 << (rng() % 11));
+		if (kind == 0) FillText(rng, data.data(), data.size());
+		else if (kind == 1) FillRandom(rng, data.data(), data.size());
+		else if (kind == 2) FillMesh(rng, data.data(), data.size());
+		else FillSparse(rng, data.data(), data.size());
+		if (!WriteFile(dir / corpus.name / kinds[kind] / (std::to_string(i) + ".bin"), data)) return {};
+		corpus.bytes += data.size();
+	}
+	return corpus;
+}
+
+static BENCH_CORPUS MakeRandom(const std::filesystem::path& dir, double scale, std::mt19937_64& rng)
+{
+	BENCH_CORPUS corpus{ "random", 0, std::max<size_t>(1, (size_t)(8 * scale)) };
+	std::vector<uint8_t> data(8 * 1024 * 1024);
+	for (size_t i = 0; i < corpus.files; i++)
+	{
+		FillRandom(rng, data.data(), data.size());
+		if (!WriteFile(dir / corpus.name / ("blob" + std::to_string(i) + ".bin"), data)) return {};
+		corpus.bytes += data.size();
+	}
+	return corpus;
+}
+
+// 1̑傫ȃt@CB́ElE1MB
+static BENCH_CORPUS MakeHuge(const std::filesystem::path& dir, double scale, std::mt19937_64& rng)
+{
+	BENCH_CORPUS corpus{ "huge.bin", 0, 1 };
+	std::vector<uint8_t> data(std::max<size_t>(1, (size_t)(256 * scale)) * 1024 * 1024);
+	const size_t chunk = 1024 * 1024;
+	for (size_t i = 0; i < data.size(); i += chunk)
+	{
+		const size_t len = std::min(chunk, data.size() - i);
+		const size_t kind = i / chunk % 3;
+		if (kind == 0) FillText(rng, data.data() + i, len);
+		else if (kind == 1) FillMesh(rng, data.data() + i, len);
+		else FillRandom(rng, data.data() + i, len);
+	}
+	if (!WriteFile(dir / corpus.name, data)) return {};
+	corpus.bytes = data.size();
+	return corpus;
+}
+
+// 1̃f[^1̐ݒňkEWJAGgǂݏoԂ𑪂
+static bool BenchArchive(std::vector<BENCH_RESULT>& results, const std::filesystem::path& work, const BENCH_CORPUS& corpus, const BENCH_CONFIG& config, unsigned repeat)
+{
+	const std::string tag = corpus.name + "/" + config.name;
+	const std::string dat = corpus.name + ".dat";
+	ARCHIVE_OPTION option;
+	option.password = "bench";
+	option.cipher = config.cipher;
+	option.root = (work / "corpus").string();
+
+	bool ok = true;
+	auto encode = Measure(repeat, [&]() { ok = EncodeArchive(option, corpus.name, config.level, config.encrypt) && ok; });
+	if (!ok) return false;
+	AddThroughput(results, "encode/" + tag, corpus.bytes, corpus.files, encode);
+
+	// WJ悪̃f[^ƏdȂȂ悤ɕʂ̃fBNgֈڂ
+	const std::filesystem::path out = work / "out";
+	std::filesystem::create_directories(out);
+	std::filesystem::rename(work / "corpus" / dat, out / dat);
+	option.root = out.string();
+	const uint64_t archive_size = std::filesystem::file_size(out / dat);
+	results.push_back({ "size/" + tag, { { "bytes", (double)corpus.bytes }, { "archive_bytes", (double)archive_size }, { "ratio", corpus.bytes ? (double)archive_size / corpus.bytes : 0.0 } } });
+
+	auto decode = Measure(repeat, [&]() { std::filesystem::remove_all(out / corpus.name); }, [&]() { ok = DecodeArchive(option, dat) && ok; });
+	if (!ok) return false;
+	AddThroughput(results, "decode/" + tag, corpus.bytes, corpus.files, decode);
+	std::filesystem::remove_all(out / corpus.name);
+
+	ARCHIVE* archive = OpenArchive(option, dat);
+	if (!archive) return false;
+	std::vector<std::string> list;
+	GetFileList(archive, list);
+	std::mt19937_64 rng(1);
+
+	// TCY߂Ăяo̓nbV\Ȃ̂ŁA܂Ƃ߂đĕς߂
+	const size_t lookups = 100000;
+	size_t found = 0;
+	const double lookup_start = Now();
+	for (size_t i = 0; i < lookups; i++) found += GetDataFromArchive(archive, list[rng() % list.size()], nullptr) != 0;
+	const double lookup = Now() - lookup_start;
+	results.push_back({ "lookup/" + tag, { { "calls", (double)lookups }, { "found", (double)found }, { "avg_us", lookup / lookups * 1e6 } } });
+
+	// ǂݏo1񂸂BǂݏoʂvŖ256MBɂȂ悤ɉ񐔂߂
+	const size_t reads = std::clamp<size_t>((size_t)(256.0 * 1024 * 1024 * corpus.files / std::max<uint64_t>(1, corpus.bytes)), 8, 10000);
+	std::vector<double> latency(reads);
+	std::vector<uint8_t> dest;
+	uint64_t read_bytes = 0;
+	for (size_t i = 0; i < reads; i++)
+	{
+		const std::string& path = list[rng() % list.size()];
+		dest.resize(GetDataFromArchive(archive, path, nullptr));
+		const double start = Now();
+		ok = GetDataFromArchive(archive, path, dest.data()) == dest.size() && ok;
+		latency[i] = Now() - start;
+		read_bytes += dest.size();
+	}
+	CloseArchive(archive);
+	if (!ok) return false;
+
+	double total = 0;
+	for (double t : latency) total += t;
+	std::sort(latency.begin(), latency.end());
+	results.push_back({ "read/" + tag, {
+		{ "calls", (double)reads },
+		{ "bytes", (double)read_bytes },
+		{ "avg_us", total / reads * 1e6 },
+		{ "p50_us", latency[reads / 2] * 1e6 },
+		{ "p99_us", latency[std::min(reads - 1, reads * 99 / 100)] * 1e6 },
+		{ "mb_per_s", total > 0 ? read_bytes / (1024.0 * 1024.0) / total : 0.0 },
+	} });
+	std::cout << "read/" << tag << ": p50 " << latency[reads / 2] * 1e6 << " us, p99 " << latency[std::min(reads - 1, reads * 99 / 100)] * 1e6 << " us" << std::endl;
+
+	std::filesystem::remove(out / dat);
+	return true;
+}
+
+// ÍEnbVEk̊֐1̃obt@ő
+static void BenchPrimitives(std::vector<BENCH_RESULT>& results, double scale, unsigned repeat)
+{
+	const size_t size = std::max<size_t>(1, (size_t)(64 * scale)) * 1024 * 1024;
+	std::mt19937_64 rng(2);
+	std::vector<uint8_t> source(size);
+	for (size_t i = 0; i < size; i += 1024 * 1024)
+		(i / (1024 * 1024) % 2 ? FillMesh : FillText)(rng, source.data() + i, std::min<size_t>(1024 * 1024, size - i));
+
+	uint8_t key[32], iv[AES_BLOCK_BYTES], hash[48];
+	FillRandom(rng, key, sizeof(key));
+	FillRandom(rng, iv, sizeof(iv));
+	AesCtx ctx;
+	AesInitKey(&ctx, key, sizeof(key));
+
+	std::vector<uint8_t> data(size + AES_BLOCK_BYTES);
+	size_t encrypted = 0;
+	auto copy = [&]() { memcpy(data.data(), source.data(), size); };
+	AddThroughput(results, "aes-cbc-encrypt", size, 1, Measure(repeat, copy, [&]() {
+		uint8_t v[AES_BLOCK_BYTES];
+		memcpy(v, iv, sizeof(v));
+		encrypted = AesEncryptCbc(&ctx, v, data.data(), size);
+	}));
+	std::vector<uint8_t> cipher(data.begin(), data.begin() + encrypted);
+	AddThroughput(results, "aes-cbc-decrypt", size, 1, Measure(repeat, [&]() { memcpy(data.data(), cipher.data(), encrypted); }, [&]() {
+		uint8_t v[AES_BLOCK_BYTES];
+		memcpy(v, iv, sizeof(v));
+		AesDecryptCbc(&ctx, v, data.data(), encrypted);
+	}));
+
+	AddThroughput(results, "sha3-384", size, 1, Measure(repeat, [&]() { SHA3_384(source.data(), size, hash); }));
+	AddThroughput(results, "crc32c", size, 1, Measure(repeat, [&]() { Crc32c(source.data(), size); }));
+	AddThroughput(results, "xorbits", size, 1, Measure(repeat, copy, [&]() { XorBits((char*)data.data(), size); }));
+
+	// deflate1{̃Xbhcompress2ƁAubNƂɕCompressParallelׂ
+	std::vector<uint8_t> pressed(compressBound((uLong)size));
+	uLongf pressed_size = 0;
+	AddThroughput(results, "deflate-6", size, 1, Measure(repeat, [&]() {
+		pressed_size = (uLongf)pressed.size();
+		compress2(pressed.data(), &pressed_size, source.data(), (uLong)size, 6);
+	}));
+	AddThroughput(results, "deflate-6-parallel", size, 1, Measure(repeat, [&]() {
+		size_t len = pressed.size();
+		CompressParallel(pressed.data(), &len, source.data(), size, 6);
+	}));
+	AddThroughput(results, "inflate", size, 1, Measure(repeat, [&]() {
+		pressed_size = (uLongf)pressed.size();
+		compress2(pressed.data(), &pressed_size, source.data(), (uLong)size, 6);
+	}, [&]() {
+		uLongf len = (uLongf)size;
+		uncompress(data.data(), &len, pressed.data(), pressed_size);
+	}));
+}
+
+static bool WriteJson(const std::string& path, const std::vector<BENCH_RESULT>& results, double scale, unsigned repeat)
+{
+	std::ofstream ofs(path);
+	const std::time_t now = std::time(nullptr);
+	char date[32];
+	std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+	ofs.precision(9);
+	ofs << "{\n";
+	ofs << "  \"date\": \"" << date << "\",\n";
+	ofs << "  \"threads\": " << GetThreadCount() << ",\n";
+	ofs << "  \"aes_accelerated\": " << (AesIsAccelerated() ? "true" : "false") << ",\n";
+	ofs << "  \"crc32c_accelerated\": " << (Crc32cIsAccelerated() ? "true" : "false") << ",\n";
+	ofs << "  \"scale\": " << scale << ",\n";
+	ofs << "  \"repeat\": " << repeat << ",\n";
+	ofs << "  \"results\": [\n";
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		ofs << "    { \"name\": \"" << results[i].name << "\"";
+		for (const auto& v : results[i].values) ofs << ", \"" << v.first << "\": " << v.second;
+		ofs << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+	}
+	ofs << "  ]\n";
+	ofs << "}\n";
+	return (bool)ofs;
+}
+
+int Bench(int argc, char** argv)
+{
+	if (argc == 1)
+	{
+		std::cout << std::endl;
+		std::cout << " Usage: " << argv[0] << " output.json [scale] [repeat] [work directory]" << std::endl;
+		std::cout << std::endl;
+		std::cout << " Ex1: " << argv[0] << " bench.json (about 600 MB of test data, 3 runs each)" << std::endl;
+		std::cout << " Ex2: " << argv[0] << " bench.json 0.1 5 D:\\tmp (one tenth of the data, 5 runs each)" << std::endl;
+		return -1;
+	}
+	const double scale = argc > 2 ? std::max(0.001, atof(argv[2])) : 1.0;
+	const unsigned repeat = argc > 3 ? std::max(1, atoi(argv[3])) : 3;
+	const std::filesystem::path work = argc > 4 ? std::filesystem::path(argv[4]) / "archive_bench" : std::filesystem::temp_directory_path() / "archive_bench";
+
+	// AES̎m̒lƍȂ΁A𑪂ĂӖȂ̂Ŏ~߂
+	if (!AesSelfTest())
+	{
+		std::cout << "AES self test failed" << std::endl;
+		return 1;
+	}
+
+	std::filesystem::remove_all(work);
+	std::mt19937_64 rng(0);
+	std::vector<BENCH_CORPUS> corpora;
+	corpora.push_back(MakeTiny(work / "corpus", scale, rng));
+	corpora.push_back(MakeMixed(work / "corpus", scale, rng));
+	corpora.push_back(MakeRandom(work / "corpus", scale, rng));
+	corpora.push_back(MakeHuge(work / "corpus", scale, rng));
+
+	bool result = true;
+	std::vector<BENCH_RESULT> results;
+	for (const auto& corpus : corpora)
+	{
+		if (corpus.name.empty())
+		{
+			std::cout << "failed to write test data to " << work.string() << std::endl;
+			result = false;
+			break;
+		}
+		for (const auto& config : bench_configs)
+		{
+			if (BenchArchive(results, work, corpus, config, repeat)) continue;
+			std::cout << "failed: " << corpus.name << "/" << config.name << std::endl;
+			result = false;
+		}
+	}
+	BenchPrimitives(results, scale, repeat);
+	std::filesystem::remove_all(work);
+
+	if (!WriteJson(argv[1], results, scale, repeat)) return 1;
+	return result ? 0 : 1;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// f[^EncodeArchiveEDecodeArchiveEGetDataFromArchiveƁAAESESHA3EXorBitsEdeflatȇx𑪂A
+// ʂJSONɏoiR~bgƂ̌ʂׂ悤ɁjBƗp̃fBNg͍Ōɍ폜B
+// @o͂JSOÑpX [f[^ʂ̔{] [JԂ] [Ɨp̃fBNg]
+int Bench(int argc, char** argv);
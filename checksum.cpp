@@ -0,0 +1,105 @@
+#include "checksum.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define CRC32C_SSE42_SUPPORTED
+#include <nmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define CRC32C_TARGET
+#else
+#include <cpuid.h>
+#define CRC32C_TARGET __attribute__((target("sse4.2")))
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
+
+// ]0x82F63B78̕\BTable[k][n]ňkoCg0ƂCRC
+struct CRC32C_TABLE {
+	uint32_t t[8][256];
+	CRC32C_TABLE() {
+		for (uint32_t n = 0; n < 256; n++) {
+			uint32_t crc = n;
+			for (int k = 0; k < 8; k++) crc = crc & 1 ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+			t[0][n] = crc;
+		}
+		for (uint32_t n = 0; n < 256; n++)
+			for (int k = 1; k < 8; k++) t[k][n] = (t[k - 1][n] >> 8) ^ t[0][t[k - 1][n] & 0xff];
+	}
+};
+static const CRC32C_TABLE Table;
+
+static uint32_t Crc32cTable(const uint8_t* data, size_t len, uint32_t crc)
+{
+	uint64_t word;
+	for (; len >= 8; len -= 8, data += 8) {
+		memcpy(&word, data, 8);
+		word ^= crc;
+		crc = Table.t[7][word & 0xff] ^ Table.t[6][(word >> 8) & 0xff] ^ Table.t[5][(word >> 16) & 0xff] ^ Table.t[4][(word >> 24) & 0xff] ^
+			Table.t[3][(word >> 32) & 0xff] ^ Table.t[2][(word >> 40) & 0xff] ^ Table.t[1][(word >> 48) & 0xff] ^ Table.t[0][word >> 56];
+	}
+	for (; len; len--) crc = (crc >> 8) ^ Table.t[0][(crc ^ *data++) & 0xff];
+	return crc;
+}
+
+#ifdef CRC32C_SSE42_SUPPORTED
+static bool CheckSse42()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 20)) != 0;
+#else
+	unsigned int a, b, c, d;
+	return __get_cpuid(1, &a, &b, &c, &d) && (c & (1 << 20));
+#endif
+}
+
+static const bool HasSse42 = CheckSse42();
+
+CRC32C_TARGET static uint32_t Crc32cHw(const uint8_t* data, size_t len, uint32_t crc)
+{
+	uint64_t word, c = crc;
+	for (; len >= 8; len -= 8, data += 8) {
+		memcpy(&word, data, 8);
+		c = _mm_crc32_u64(c, word);
+	}
+	crc = (uint32_t)c;
+	for (; len; len--) crc = _mm_crc32_u8(crc, *data++);
+	return crc;
+}
+#elif defined(__ARM_FEATURE_CRC32)
+static uint32_t Crc32cHw(const uint8_t* data, size_t len, uint32_t crc)
+{
+	uint64_t word;
+	for (; len >= 8; len -= 8, data += 8) {
+		memcpy(&word, data, 8);
+		crc = __crc32cd(crc, word);
+	}
+	for (; len; len--) crc = __crc32cb(crc, *data++);
+	return crc;
+}
+#endif
+
+uint32_t Crc32c(const void* data, size_t len, uint32_t crc)
+{
+	crc = ~crc;
+#if defined(CRC32C_SSE42_SUPPORTED)
+	if (HasSse42) return ~Crc32cHw((const uint8_t*)data, len, crc);
+#elif defined(__ARM_FEATURE_CRC32)
+	return ~Crc32cHw((const uint8_t*)data, len, crc);
+#endif
+	return ~Crc32cTable((const uint8_t*)data, len, crc);
+}
+
+bool Crc32cIsAccelerated()
+{
+#if defined(CRC32C_SSE42_SUPPORTED)
+	return HasSse42;
+#elif defined(__ARM_FEATURE_CRC32)
+	return true;
+#else
+	return false;
+#endif
+}
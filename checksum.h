@@ -0,0 +1,8 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// CRC32CiCastagnolijBcrcɑO̖߂lnΑvZłB
+// SSE4.2ARMv8CRC߂ΎgAȂ8oCg\ČvZB
+uint32_t Crc32c(const void* data, size_t len, uint32_t crc = 0);
+bool Crc32cIsAccelerated();
@@ -0,0 +1,216 @@
+#include "compress.h"
+#include "parallel.h"
+#include "pool.h"
+#include "stats.h"
+#include "zlib\zlib.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+struct COMPRESS_BLOCK {
+	std::vector<uint8_t> data;
+	uLong adler;
+	int result;
+};
+
+static int GetHeaderLevel(int level)
+{
+	if (level == Z_DEFAULT_COMPRESSION) level = 6;
+	return level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3;
+}
+
+static int CompressBlock(COMPRESS_BLOCK& block, const uint8_t* source, size_t offset, size_t len, bool prime, bool last, int level, int strategy)
+{
+	z_stream strm{};
+	int ret = deflateInit2(&strm, level, Z_DEFLATED, -MAX_WBITS, 8, strategy);
+	if (ret != Z_OK) return ret;
+
+	if (prime) {
+		size_t dict = std::min(offset, COMPRESS_DICT_SIZE);
+		deflateSetDictionary(&strm, source + offset - dict, (uInt)dict);
+	}
+
+	// ŏIubNȊOZ_SYNC_FLUSHŃoCgEɑÃubN̂܂ܘAł悤ɂ
+	const int flush = last ? Z_FINISH : Z_SYNC_FLUSH;
+	const size_t bound = deflateBound(&strm, (uLong)len) + 16;
+	strm.next_in = (Bytef*)source + offset;
+	strm.avail_in = (uInt)len;
+	do {
+		block.data.resize(strm.total_out + bound);
+		strm.next_out = block.data.data() + strm.total_out;
+		strm.avail_out = (uInt)bound;
+		ret = deflate(&strm, flush);
+	} while (ret == Z_OK && strm.avail_out == 0);
+
+	block.data.resize(strm.total_out);
+	block.adler = adler32(adler32(0, Z_NULL, 0), source + offset, (uInt)len);
+	deflateEnd(&strm);
+
+	if (ret == Z_STREAM_END || (!last && ret == Z_OK)) return Z_OK;
+	return ret == Z_OK ? Z_BUF_ERROR : ret;
+}
+
+static size_t GetBlockCount(size_t sourceLen)
+{
+	return sourceLen ? (sourceLen + COMPRESS_BLOCK_SIZE - 1) / COMPRESS_BLOCK_SIZE : 1;
+}
+
+size_t GetRestartCount(size_t sourceLen)
+{
+	return (GetBlockCount(sourceLen) - 1) / (COMPRESS_RESTART_SIZE / COMPRESS_BLOCK_SIZE);
+}
+
+int CompressParallel(uint8_t* dest, size_t* destLen, const uint8_t* source, size_t sourceLen, int level, std::vector<COMPRESS_RESTART>* restarts, unsigned threads, const COMPRESS_SINK& sink, int strategy, STATS_SCOPE* stats)
+{
+	if (threads == 0) threads = GetThreadCount();
+	if (restarts) restarts->clear();
+	constexpr size_t restart_blocks = COMPRESS_RESTART_SIZE / COMPRESS_BLOCK_SIZE;
+	auto is_restart = [&](size_t k) { return restarts && k && k % restart_blocks == 0; };
+
+	const size_t count = GetBlockCount(sourceLen);
+	const size_t window = (size_t)threads * 8;
+	std::vector<COMPRESS_BLOCK> blocks(std::min(count, window));
+
+	if (*destLen < 6) return Z_BUF_ERROR;
+	uint32_t header = (0x78 << 8) | (GetHeaderLevel(level) << 6);
+	header += 31 - header % 31;
+	size_t size = 0;
+	dest[size++] = (uint8_t)(header >> 8);
+	dest[size++] = (uint8_t)header;
+
+	// o͂𗭂ߍ݂Ȃ悤AXbh~8ubNkďo
+	uLong adler = adler32(0, Z_NULL, 0);
+	for (size_t base = 0; base < count; base += window)
+	{
+		const size_t num = std::min(window, count - base);
+		ParallelFor(num, [&](size_t i) {
+			const size_t offset = (base + i) * COMPRESS_BLOCK_SIZE;
+			const size_t len = std::min(COMPRESS_BLOCK_SIZE, sourceLen - offset);
+			STATS_SPAN span(stats, ARCHIVE_PHASE_COMPRESS);
+			blocks[i].result = CompressBlock(blocks[i], source, offset, len, offset && !is_restart(base + i), base + i == count - 1, level, strategy);
+		}, threads);
+
+		for (size_t i = 0; i < num; i++)
+		{
+			if (blocks[i].result != Z_OK) return blocks[i].result;
+			if (size + blocks[i].data.size() + 4 > *destLen) return Z_BUF_ERROR;
+			if (is_restart(base + i)) restarts->push_back({ size, (base + i) * COMPRESS_BLOCK_SIZE });
+			memcpy(dest + size, blocks[i].data.data(), blocks[i].data.size());
+			size += blocks[i].data.size();
+			if (sink) sink(dest, size);
+
+			const size_t len = std::min(COMPRESS_BLOCK_SIZE, sourceLen - (base + i) * COMPRESS_BLOCK_SIZE);
+			adler = adler32_combine(adler, blocks[i].adler, (z_off_t)len);
+		}
+	}
+
+	dest[size++] = (uint8_t)(adler >> 24);
+	dest[size++] = (uint8_t)(adler >> 16);
+	dest[size++] = (uint8_t)(adler >> 8);
+	dest[size++] = (uint8_t)adler;
+	if (sink) sink(dest, size);
+	*destLen = size;
+	return Z_OK;
+}
+
+static int InflateSegment(uint8_t* dest, size_t destLen, const uint8_t* source, size_t begin, size_t end, bool last, size_t segment, const UNCOMPRESS_FILTER& filter)
+{
+	z_stream strm{};
+	int ret = inflateInit2(&strm, -MAX_WBITS);
+	if (ret != Z_OK) return ret;
+
+	// uIntɎ܂Pʂœni4GB𒴂Ԃ̂܂܈jBfilterL2Ɏ܂PʂŕϊȂn
+	const size_t chunk = (size_t)1 << 30;
+	POOL_BUFFER buffer;
+	if (filter) buffer = POOL_BUFFER(COMPRESS_FILTER_SIZE);
+	uint8_t* const out_end = dest + destLen;
+	size_t pos = begin;
+	strm.next_out = dest;
+	do {
+		if (strm.avail_in == 0 && pos < end)
+		{
+			const size_t len = filter ? std::min(end, pos / COMPRESS_FILTER_SIZE * COMPRESS_FILTER_SIZE + COMPRESS_FILTER_SIZE) - pos : std::min(end - pos, chunk);
+			if (filter) filter(segment, pos, len, buffer.data);
+			strm.next_in = filter ? buffer.data : (Bytef*)source + pos;
+			strm.avail_in = (uInt)len;
+			pos += len;
+		}
+		strm.avail_out = (uInt)std::min<size_t>(out_end - strm.next_out, chunk);
+		ret = inflate(&strm, Z_NO_FLUSH);
+	} while (ret == Z_OK);
+
+	// r̋ԂZ_SYNC_FLUSHŏÎŁA͂g؂ďo͂傤ǖ܂ΐ
+	const bool done = strm.next_out == out_end && (last ? ret == Z_STREAM_END : pos == end && strm.avail_in == 0);
+	inflateEnd(&strm);
+	if (done) return Z_OK;
+	return ret == Z_NEED_DICT || ret == Z_MEM_ERROR ? ret : Z_DATA_ERROR;
+}
+
+int UncompressParallel(uint8_t* dest, size_t* destLen, const uint8_t* source, size_t sourceLen, const COMPRESS_RESTART* restarts, size_t restart_num, unsigned threads, const UNCOMPRESS_FILTER& filter, STATS_SCOPE* stats)
+{
+	if (sourceLen < 6) return Z_DATA_ERROR;
+	uint8_t header[2] = { source[0], source[1] };
+	if (filter) filter(0, 0, 2, header);
+	if ((header[0] & 0x0f) != Z_DEFLATED || ((header[0] << 8) | header[1]) % 31 || (header[1] & 0x20)) return Z_DATA_ERROR;
+
+	const size_t count = restart_num + 1;
+	auto begin = [&](size_t k) { return k ? restarts[k - 1] : COMPRESS_RESTART{ 2, 0 }; };
+	auto end = [&](size_t k) { return k < restart_num ? restarts[k] : COMPRESS_RESTART{ sourceLen - 4, *destLen }; };
+	for (size_t k = 0; k < count; k++)
+		if (begin(k).pressed > end(k).pressed || begin(k).original > end(k).original) return Z_DATA_ERROR;
+
+	std::vector<int> results(count);
+	std::vector<uLong> adlers(count);
+	ParallelFor(count, [&](size_t k) {
+		const COMPRESS_RESTART b = begin(k), e = end(k);
+		STATS_SPAN span(stats, ARCHIVE_PHASE_COMPRESS);
+		results[k] = InflateSegment(dest + b.original, e.original - b.original, source, b.pressed, e.pressed, k == restart_num, k, filter);
+		adlers[k] = adler32_z(adler32(0, Z_NULL, 0), dest + b.original, e.original - b.original);
+	}, threads);
+
+	uLong adler = adlers[0];
+	for (size_t k = 0; k < count; k++)
+	{
+		if (results[k] != Z_OK) return results[k];
+		if (k) adler = adler32_combine(adler, adlers[k], (z_off_t)(end(k).original - begin(k).original));
+	}
+
+	uint8_t trailer[4];
+	memcpy(trailer, source + sourceLen - 4, 4);
+	if (filter) filter(restart_num, sourceLen - 4, 4, trailer);
+	if (adler != ((uLong)trailer[0] << 24 | (uLong)trailer[1] << 16 | (uLong)trailer[2] << 8 | trailer[3])) return Z_DATA_ERROR;
+	return Z_OK;
+}
+
+// Z͎͂Ԃ̎Ԃɖ̂ŁA킹COMPRESS_TRIAL_TIME𒴂܂ŌJԂĕς
+constexpr double COMPRESS_TRIAL_TIME = 0.005;
+constexpr int COMPRESS_TRIAL_REPEAT = 64;
+
+std::vector<COMPRESS_TRIAL> CompressTrial(const uint8_t* source, size_t sourceLen, const std::vector<COMPRESS_SETTING>& settings)
+{
+	auto seconds = [](std::chrono::steady_clock::time_point begin) { return std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count(); };
+	std::vector<uint8_t> pressed(sourceLen + sourceLen / 7 + 1024), original(sourceLen);
+	std::vector<COMPRESS_TRIAL> trials;
+	for (const COMPRESS_SETTING& setting : settings)
+	{
+		COMPRESS_TRIAL trial = { setting, 0, 0, 0 };
+		int ret = Z_OK, n = 0;
+		for (; ret == Z_OK && n < COMPRESS_TRIAL_REPEAT && trial.compress_seconds + trial.uncompress_seconds < COMPRESS_TRIAL_TIME; n++)
+		{
+			size_t size = pressed.size(), len = sourceLen;
+			auto begin = std::chrono::steady_clock::now();
+			ret = CompressParallel(pressed.data(), &size, source, sourceLen, setting.level, nullptr, 1, nullptr, setting.strategy);
+			trial.compress_seconds += seconds(begin);
+			if (ret != Z_OK) break;
+			begin = std::chrono::steady_clock::now();
+			UncompressParallel(original.data(), &len, pressed.data(), size, nullptr, 0, 1);
+			trial.uncompress_seconds += seconds(begin);
+			trial.pressed = size;
+		}
+		if (ret != Z_OK) continue;
+		trial.compress_seconds /= n;
+		trial.uncompress_seconds /= n;
+		trials.push_back(trial);
+	}
+	return trials;
+}
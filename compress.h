@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+constexpr size_t COMPRESS_BLOCK_SIZE = 128 * 1024;
+constexpr size_t COMPRESS_DICT_SIZE = 32 * 1024;
+constexpr size_t COMPRESS_RESTART_SIZE = 32 * COMPRESS_BLOCK_SIZE;
+constexpr size_t COMPRESS_FILTER_SIZE = 64 * 1024;
+
+// g킸ɈkubN̊JnʒuiPƂœWJłj
+struct COMPRESS_RESTART {
+	size_t pressed;
+	size_t original;
+};
+
+// o͂̐擪sizeoCgm肷邽тɌĂ΂BLbVɂ邤ɈÍ̂ɎgB
+typedef std::function<void(uint8_t* dest, size_t size)> COMPRESS_SINK;
+
+// WJO̓͂ϊiȂǁjBsource[offset, offset + len)ϊoutɏB
+// segmentrestartsŋ؂Ԃ̔ԍŁAԂƂɕʂ̃XbhAԂ̒łoffset̏ɌĂ΂B
+// Ԃ̓rłoffset + lenCOMPRESS_FILTER_SIZE̔{ɂȂ悤ɋ؂B
+typedef std::function<void(size_t segment, size_t offset, size_t len, uint8_t* out)> UNCOMPRESS_FILTER;
+
+struct STATS_SCOPE;
+
+// ͂COMPRESS_BLOCK_SIZEƂɕAO32KBƂăXbhƂɈkB
+// o͂1{zlibXg[ɂȂ̂uncompressł̂܂ܓWJłB߂lzlib̃G[R[hB
+// restartsnCOMPRESS_RESTART_SIZEƂɎ؂ÄʒuL^B
+// strategydeflateInit2ɓni0Z_DEFAULT_STRATEGYBWJɂ͉eȂjB
+// statsnƁAubNk鎞Ԃꂼ̃XbhARCHIVE_PHASE_COMPRESSɐB
+int CompressParallel(uint8_t* dest, size_t* destLen, const uint8_t* source, size_t sourceLen, int level, std::vector<COMPRESS_RESTART>* restarts = nullptr, unsigned threads = 0, const COMPRESS_SINK& sink = nullptr, int strategy = 0, STATS_SCOPE* stats = nullptr);
+// CompressParallelsourceLenoCg̓͂ɑ΂restartsɋL^鐔ikOɃwb_̑傫߂邽߁j
+size_t GetRestartCount(size_t sourceLen);
+
+// k̃xƕizlibZ_FILTEREDZ_RLEȂǁj
+struct COMPRESS_SETTING {
+	int level;
+	int strategy;
+};
+
+// ʁBԂ1Xbhőb
+struct COMPRESS_TRIAL {
+	COMPRESS_SETTING setting;
+	size_t pressed;
+	double compress_seconds, uncompress_seconds;
+};
+
+// sourceݒ育Ƃ1XbhCompressParallelUncompressParallelɒʂA傫ƎԂ𑪂iݒIԂ߂̌{ɎgjB
+// Z͉͂xJԂ1񂠂̎Ԃɂ
+std::vector<COMPRESS_TRIAL> CompressTrial(const uint8_t* source, size_t sourceLen, const std::vector<COMPRESS_SETTING>& settings);
+
+// restartsŋ؂ԂƂɃXbhœWJB*destLenɂ͓WJ̃TCY𐳊mɎw肷邱ƁB
+// restart_num0ȂuncompressƓ擪珇ɓWJBfilternsourceϊȂWJB
+// statsCompressParallelƓԂƂ̓WJ̎Ԃ𐔂ifilter̒ŐԂ͏jB
+int UncompressParallel(uint8_t* dest, size_t* destLen, const uint8_t* source, size_t sourceLen, const COMPRESS_RESTART* restarts = nullptr, size_t restart_num = 0, unsigned threads = 0, const UNCOMPRESS_FILTER& filter = nullptr, STATS_SCOPE* stats = nullptr);
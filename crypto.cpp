@@ -1,5 +1,21 @@
 #include "crypto.h"
+#include "parallel.h"
 #include <stdint.h>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define AES_NI_SUPPORTED
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define AES_NI_TARGET
+#define AES_CLMUL_TARGET
+#else
+#include <cpuid.h>
+#define AES_NI_TARGET __attribute__((target("aes,sse2")))
+#define AES_CLMUL_TARGET __attribute__((target("pclmul,sse2")))
+#endif
+#endif
 
 static const uint8_t SBox[] = {
 	0x63, 0x7C, 0x77, 0x7B, 0xF2, 0x6B, 0x6F, 0xC5, 0x30, 0x01, 0x67, 0x2B, 0xFE, 0xD7, 0xAB, 0x76,
@@ -60,6 +76,20 @@ static void MixColumnsR(uint8_t* state)
 }
 
 
+// Round keys for the equivalent inverse cipher used by the table-driven decryption
+static void AesInitKeyR(AesCtx* Ctx)
+{
+	uint8_t i;
+
+	memcpy(&Ctx->KeyR[0], &Ctx->Key[Ctx->rounds << 2], AES_BLOCK_BYTES);
+	for (i = 1; i < Ctx->rounds; i++)
+	{
+		memcpy(&Ctx->KeyR[i << 2], &Ctx->Key[(Ctx->rounds - i) << 2], AES_BLOCK_BYTES);
+		MixColumnsR((uint8_t*)&Ctx->KeyR[i << 2]);
+	}
+	memcpy(&Ctx->KeyR[Ctx->rounds << 2], &Ctx->Key[0], AES_BLOCK_BYTES);
+}
+
 static uint32_t SubDword(uint32_t v)
 {
 	uint8_t* b = (uint8_t*)&v;
@@ -92,6 +122,8 @@ void AesInitKey(AesCtx* Ctx, const uint8_t* Key, int RijndaelKeyBytes)
 
 		Ctx->Key[i] = Ctx->Key[i - RijndaelKeyDwords] ^ temp;
 	}
+
+	AesInitKeyR(Ctx);
 }
 
 static void SubBytes(uint8_t* block)
@@ -125,7 +157,7 @@ static void MixColumns(uint8_t* state)
 }
 
 
-void AesEncryptBlock(const AesCtx* const Ctx, void* _block)
+void AesEncryptBlockRef(const AesCtx* const Ctx, void* _block)
 {
 	uint8_t* block = (uint8_t*)_block;
 	uint8_t i;
@@ -183,17 +215,161 @@ static void SubBytesR(uint8_t* block)
 		block[i] = GetSBoxR(block[i]);
 }
 
-size_t AesEncryptCbc(const AesCtx* const Ctx, void* _iv, void* _data, size_t len)
+// CTR keystream is generated AES_CTR_BLOCKS blocks at a time so the AES-NI rounds can be interleaved
+#define AES_CTR_BLOCKS 8
+#define AES_CBC_BLOCKS 8
+#define AES_CBC_BLOCKS_TABLE 4
+
+static inline uint64_t Swap64(uint64_t v)
 {
-	uint8_t* iv = (uint8_t*)_iv, * data = (uint8_t*)_data;
+	v = (v & 0x00FF00FF00FF00FFull) << 8 | (v >> 8 & 0x00FF00FF00FF00FFull);
+	v = (v & 0x0000FFFF0000FFFFull) << 16 | (v >> 16 & 0x0000FFFF0000FFFFull);
+	return v << 32 | v >> 32;
+}
 
-	// Pad up to blocksize inclusive
+// AES-NI path. Round keys come from AesInitKey (the archive schedule is not the FIPS-197 one,
+// so AESKEYGENASSIST cannot be used); KeyR already holds the InvMixColumns keys AESDEC expects.
+static bool CheckAesNi()
+{
+#if defined(AES_NI_SUPPORTED) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 25)) && (info[3] & (1 << 26));
+#elif defined(AES_NI_SUPPORTED)
+	unsigned int a, b, c, d;
+	return __get_cpuid(1, &a, &b, &c, &d) && (c & (1 << 25)) && (d & (1 << 26));
+#else
+	return false;
+#endif
+}
+
+static const bool HasAesNi = CheckAesNi();
+
+static bool CheckClmul()
+{
+#if defined(AES_NI_SUPPORTED) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 1);
+	return (info[2] & (1 << 1)) && (info[3] & (1 << 26));
+#elif defined(AES_NI_SUPPORTED)
+	unsigned int a, b, c, d;
+	return __get_cpuid(1, &a, &b, &c, &d) && (c & (1 << 1)) && (d & (1 << 26));
+#else
+	return false;
+#endif
+}
+
+static const bool HasClmul = CheckClmul();
+
+bool AesIsAccelerated()
+{
+	return HasAesNi;
+}
+
+#ifdef AES_NI_SUPPORTED
+AES_NI_TARGET static void LoadKeysNi(__m128i* k, const uint32_t* Key, uint8_t rounds)
+{
+	uint8_t i;
+	for (i = 0; i <= rounds; i++) k[i] = _mm_loadu_si128((const __m128i*)(Key + (i << 2)));
+}
+
+AES_NI_TARGET static inline __m128i EncryptNi(__m128i s, const __m128i* k, uint8_t rounds)
+{
+	uint8_t i;
+	s = _mm_xor_si128(s, k[0]);
+	for (i = 1; i < rounds; i++) s = _mm_aesenc_si128(s, k[i]);
+	return _mm_aesenclast_si128(s, k[rounds]);
+}
+
+AES_NI_TARGET static inline __m128i DecryptNi(__m128i s, const __m128i* k, uint8_t rounds)
+{
+	uint8_t i;
+	s = _mm_xor_si128(s, k[0]);
+	for (i = 1; i < rounds; i++) s = _mm_aesdec_si128(s, k[i]);
+	return _mm_aesdeclast_si128(s, k[rounds]);
+}
+
+AES_NI_TARGET static void EncryptBlockNi(const AesCtx* const Ctx, void* _block)
+{
+	__m128i k[15];
+	LoadKeysNi(k, Ctx->Key, Ctx->rounds);
+	_mm_storeu_si128((__m128i*)_block, EncryptNi(_mm_loadu_si128((const __m128i*)_block), k, Ctx->rounds));
+}
+
+AES_NI_TARGET static void DecryptBlockNi(const AesCtx* const Ctx, void* _block)
+{
+	__m128i k[15];
+	LoadKeysNi(k, Ctx->KeyR, Ctx->rounds);
+	_mm_storeu_si128((__m128i*)_block, DecryptNi(_mm_loadu_si128((const __m128i*)_block), k, Ctx->rounds));
+}
+
+AES_NI_TARGET static void EncryptCbcNi(const AesCtx* const Ctx, const uint8_t* iv, uint8_t* data, size_t len)
+{
+	__m128i k[15], x;
 	size_t i;
-	uint8_t pad = (~len & (AES_BLOCK_BYTES - 1)) + 1;
-	memset(data + len, pad, pad);
-	len += pad;
 
-	if (!data) return len;
+	LoadKeysNi(k, Ctx->Key, Ctx->rounds);
+	x = iv ? _mm_loadu_si128((const __m128i*)iv) : _mm_setzero_si128();
+	for (i = 0; i < len; i += AES_BLOCK_BYTES)
+	{
+		x = EncryptNi(_mm_xor_si128(x, _mm_loadu_si128((const __m128i*)(data + i))), k, Ctx->rounds);
+		_mm_storeu_si128((__m128i*)(data + i), x);
+	}
+}
+
+// CBC decryption has no dependency between blocks, so AES_CBC_BLOCKS blocks go through the rounds together
+AES_NI_TARGET static void DecryptCbcNi(const AesCtx* const Ctx, const uint8_t* iv, uint8_t* data, size_t len)
+{
+	__m128i k[15], prev, c, cc[AES_CBC_BLOCKS], b[AES_CBC_BLOCKS];
+	size_t i;
+	uint8_t r, j;
+
+	LoadKeysNi(k, Ctx->KeyR, Ctx->rounds);
+	prev = iv ? _mm_loadu_si128((const __m128i*)iv) : _mm_setzero_si128();
+	for (i = 0; i + AES_BLOCK_BYTES * AES_CBC_BLOCKS <= len; i += AES_BLOCK_BYTES * AES_CBC_BLOCKS)
+	{
+		for (j = 0; j < AES_CBC_BLOCKS; j++)
+		{
+			cc[j] = _mm_loadu_si128((const __m128i*)(data + i + j * AES_BLOCK_BYTES));
+			b[j] = _mm_xor_si128(cc[j], k[0]);
+		}
+		for (r = 1; r < Ctx->rounds; r++)
+			for (j = 0; j < AES_CBC_BLOCKS; j++) b[j] = _mm_aesdec_si128(b[j], k[r]);
+		for (j = 0; j < AES_CBC_BLOCKS; j++)
+		{
+			b[j] = _mm_xor_si128(_mm_aesdeclast_si128(b[j], k[Ctx->rounds]), j ? cc[j - 1] : prev);
+			_mm_storeu_si128((__m128i*)(data + i + j * AES_BLOCK_BYTES), b[j]);
+		}
+		prev = cc[AES_CBC_BLOCKS - 1];
+	}
+	for (; i < len; i += AES_BLOCK_BYTES)
+	{
+		c = _mm_loadu_si128((const __m128i*)(data + i));
+		_mm_storeu_si128((__m128i*)(data + i), _mm_xor_si128(DecryptNi(c, k, Ctx->rounds), prev));
+		prev = c;
+	}
+}
+
+AES_NI_TARGET static void CtrKeystreamNi(const AesCtx* const Ctx, uint64_t nonce, uint64_t counter, uint8_t* ks)
+{
+	__m128i k[15], b[AES_CTR_BLOCKS];
+	uint8_t i, j;
+
+	LoadKeysNi(k, Ctx->Key, Ctx->rounds);
+	for (j = 0; j < AES_CTR_BLOCKS; j++) b[j] = _mm_xor_si128(_mm_set_epi64x((long long)Swap64(counter + j), (long long)nonce), k[0]);
+	for (i = 1; i < Ctx->rounds; i++)
+		for (j = 0; j < AES_CTR_BLOCKS; j++) b[j] = _mm_aesenc_si128(b[j], k[i]);
+	for (j = 0; j < AES_CTR_BLOCKS; j++) _mm_storeu_si128((__m128i*)(ks + j * AES_BLOCK_BYTES), _mm_aesenclast_si128(b[j], k[Ctx->rounds]));
+}
+#endif
+
+static void EncryptCbc(const AesCtx* const Ctx, const uint8_t* iv, uint8_t* data, size_t len)
+{
+	size_t i;
+
+#ifdef AES_NI_SUPPORTED
+	if (HasAesNi) return EncryptCbcNi(Ctx, iv, data, len);
+#endif
 
 	if (iv) XorBlock(iv, data);
 	AesEncryptBlock(Ctx, data);
@@ -204,11 +380,24 @@ size_t AesEncryptCbc(const AesCtx* const Ctx, void* _iv, void* _data, size_t len
 		data += AES_BLOCK_BYTES;
 		AesEncryptBlock(Ctx, data);
 	}
+}
 
+size_t AesEncryptCbc(const AesCtx* const Ctx, void* _iv, void* _data, size_t len)
+{
+	uint8_t* iv = (uint8_t*)_iv, * data = (uint8_t*)_data;
+
+	// Pad up to blocksize inclusive
+	uint8_t pad = (~len & (AES_BLOCK_BYTES - 1)) + 1;
+	memset(data + len, pad, pad);
+	len += pad;
+
+	if (!data) return len;
+
+	EncryptCbc(Ctx, iv, data, len);
 	return len;
 }
 
-void AesDecryptBlock(const AesCtx* const Ctx, void* _block)
+void AesDecryptBlockRef(const AesCtx* const Ctx, void* _block)
 {
 	uint8_t* block = (uint8_t*)_block;
 	uint8_t i;
@@ -228,19 +417,707 @@ void AesDecryptBlock(const AesCtx* const Ctx, void* _block)
 }
 
 
-size_t AesDecryptCbc(const AesCtx* const Ctx, void* _iv, void* _data, size_t len)
+// Table-driven implementation: SubBytes, ShiftRows and MixColumns fused into four
+// 32-bit lookups per column. The tables are built once from SBox/SBoxR.
+#define ROL32(v, n)  ( (v) << n | (v) >> (32 - n) )
+
+static struct AesTables
 {
-	uint8_t* iv = (uint8_t*)_iv, * data = (uint8_t*)_data;
-	uint8_t* cc;
+	uint32_t Te[4][256];
+	uint32_t Td[4][256];
+
+	AesTables()
+	{
+		uint32_t i, s, r;
+		for (i = 0; i < 256; i++)
+		{
+			s = SBox[i];
+			Te[0][i] = (Mul2(s) & 0xff) | s << 8 | s << 16 | (Mul3(s) & 0xff) << 24;
+
+			r = SBoxR[i];
+			Td[0][i] = (MulE(r) & 0xff) | (Mul9(r) & 0xff) << 8 | (MulD(r) & 0xff) << 16 | (MulB(r) & 0xff) << 24;
+
+			Te[1][i] = ROL32(Te[0][i], 8); Te[2][i] = ROL32(Te[0][i], 16); Te[3][i] = ROL32(Te[0][i], 24);
+			Td[1][i] = ROL32(Td[0][i], 8); Td[2][i] = ROL32(Td[0][i], 16); Td[3][i] = ROL32(Td[0][i], 24);
+		}
+	}
+} const Tables;
+
+#define TE(a, b, c, d) (Tables.Te[0][(a) & 0xff] ^ Tables.Te[1][((b) >> 8) & 0xff] ^ Tables.Te[2][((c) >> 16) & 0xff] ^ Tables.Te[3][(d) >> 24])
+#define TD(a, b, c, d) (Tables.Td[0][(a) & 0xff] ^ Tables.Td[1][((b) >> 8) & 0xff] ^ Tables.Td[2][((c) >> 16) & 0xff] ^ Tables.Td[3][(d) >> 24])
+#define SE(a, b, c, d) ((uint32_t)SBox[(a) & 0xff] | (uint32_t)SBox[((b) >> 8) & 0xff] << 8 | (uint32_t)SBox[((c) >> 16) & 0xff] << 16 | (uint32_t)SBox[(d) >> 24] << 24)
+#define SD(a, b, c, d) ((uint32_t)SBoxR[(a) & 0xff] | (uint32_t)SBoxR[((b) >> 8) & 0xff] << 8 | (uint32_t)SBoxR[((c) >> 16) & 0xff] << 16 | (uint32_t)SBoxR[(d) >> 24] << 24)
+
+static void EncryptBlockTable(const AesCtx* const Ctx, void* _block)
+{
+	const uint32_t* rk = Ctx->Key;
+	uint32_t s[4], t[4];
+	uint8_t i;
+
+	memcpy(s, _block, AES_BLOCK_BYTES);
+	s[0] ^= rk[0]; s[1] ^= rk[1]; s[2] ^= rk[2]; s[3] ^= rk[3];
+
+	for (i = 1; i < Ctx->rounds; i++)
+	{
+		rk += 4;
+		t[0] = TE(s[0], s[1], s[2], s[3]) ^ rk[0];
+		t[1] = TE(s[1], s[2], s[3], s[0]) ^ rk[1];
+		t[2] = TE(s[2], s[3], s[0], s[1]) ^ rk[2];
+		t[3] = TE(s[3], s[0], s[1], s[2]) ^ rk[3];
+		memcpy(s, t, AES_BLOCK_BYTES);
+	}
+
+	rk += 4;
+	t[0] = SE(s[0], s[1], s[2], s[3]) ^ rk[0];
+	t[1] = SE(s[1], s[2], s[3], s[0]) ^ rk[1];
+	t[2] = SE(s[2], s[3], s[0], s[1]) ^ rk[2];
+	t[3] = SE(s[3], s[0], s[1], s[2]) ^ rk[3];
+	memcpy(_block, t, AES_BLOCK_BYTES);
+}
+
+static void DecryptBlockTable(const AesCtx* const Ctx, void* _block)
+{
+	const uint32_t* rk = Ctx->KeyR;
+	uint32_t s[4], t[4];
+	uint8_t i;
+
+	memcpy(s, _block, AES_BLOCK_BYTES);
+	s[0] ^= rk[0]; s[1] ^= rk[1]; s[2] ^= rk[2]; s[3] ^= rk[3];
 
-	for (cc = data + len - AES_BLOCK_BYTES; cc > data; cc -= AES_BLOCK_BYTES)
+	for (i = 1; i < Ctx->rounds; i++)
 	{
-		AesDecryptBlock(Ctx, cc);
-		XorBlock(cc - AES_BLOCK_BYTES, cc);
+		rk += 4;
+		t[0] = TD(s[0], s[3], s[2], s[1]) ^ rk[0];
+		t[1] = TD(s[1], s[0], s[3], s[2]) ^ rk[1];
+		t[2] = TD(s[2], s[1], s[0], s[3]) ^ rk[2];
+		t[3] = TD(s[3], s[2], s[1], s[0]) ^ rk[3];
+		memcpy(s, t, AES_BLOCK_BYTES);
 	}
 
-	AesDecryptBlock(Ctx, cc);
-	if (iv) XorBlock(iv, cc);
+	rk += 4;
+	t[0] = SD(s[0], s[3], s[2], s[1]) ^ rk[0];
+	t[1] = SD(s[1], s[0], s[3], s[2]) ^ rk[1];
+	t[2] = SD(s[2], s[1], s[0], s[3]) ^ rk[2];
+	t[3] = SD(s[3], s[2], s[1], s[0]) ^ rk[3];
+	memcpy(_block, t, AES_BLOCK_BYTES);
+}
+
+void AesEncryptBlock(const AesCtx* const Ctx, void* _block)
+{
+#ifdef AES_NI_SUPPORTED
+	if (HasAesNi) return EncryptBlockNi(Ctx, _block);
+#endif
+	EncryptBlockTable(Ctx, _block);
+}
+
+void AesDecryptBlock(const AesCtx* const Ctx, void* _block)
+{
+#ifdef AES_NI_SUPPORTED
+	if (HasAesNi) return DecryptBlockNi(Ctx, _block);
+#endif
+	DecryptBlockTable(Ctx, _block);
+}
+
+// Four blocks through the rounds side by side so the table lookups of one block hide the latency of the others
+static void DecryptBlocksTable(const AesCtx* const Ctx, uint8_t* blocks)
+{
+	const uint32_t* rk = Ctx->KeyR;
+	uint32_t s[AES_CBC_BLOCKS_TABLE][4], t[AES_CBC_BLOCKS_TABLE][4];
+	uint8_t i, j;
+
+	memcpy(s, blocks, sizeof(s));
+	for (j = 0; j < AES_CBC_BLOCKS_TABLE; j++)
+	{
+		s[j][0] ^= rk[0]; s[j][1] ^= rk[1]; s[j][2] ^= rk[2]; s[j][3] ^= rk[3];
+	}
+
+	for (i = 1; i < Ctx->rounds; i++)
+	{
+		rk += 4;
+		for (j = 0; j < AES_CBC_BLOCKS_TABLE; j++)
+		{
+			t[j][0] = TD(s[j][0], s[j][3], s[j][2], s[j][1]) ^ rk[0];
+			t[j][1] = TD(s[j][1], s[j][0], s[j][3], s[j][2]) ^ rk[1];
+			t[j][2] = TD(s[j][2], s[j][1], s[j][0], s[j][3]) ^ rk[2];
+			t[j][3] = TD(s[j][3], s[j][2], s[j][1], s[j][0]) ^ rk[3];
+		}
+		memcpy(s, t, sizeof(s));
+	}
+
+	rk += 4;
+	for (j = 0; j < AES_CBC_BLOCKS_TABLE; j++)
+	{
+		t[j][0] = SD(s[j][0], s[j][3], s[j][2], s[j][1]) ^ rk[0];
+		t[j][1] = SD(s[j][1], s[j][0], s[j][3], s[j][2]) ^ rk[1];
+		t[j][2] = SD(s[j][2], s[j][1], s[j][0], s[j][3]) ^ rk[2];
+		t[j][3] = SD(s[j][3], s[j][2], s[j][1], s[j][0]) ^ rk[3];
+	}
+	memcpy(blocks, t, sizeof(t));
+}
+
+static void DecryptCbc(const AesCtx* const Ctx, const uint8_t* iv, uint8_t* data, size_t len)
+{
+#ifdef AES_NI_SUPPORTED
+	if (HasAesNi) return DecryptCbcNi(Ctx, iv, data, len);
+#endif
+	uint8_t prev[AES_BLOCK_BYTES], cc[AES_BLOCK_BYTES * AES_CBC_BLOCKS_TABLE];
+	size_t i, size;
+
+	memcpy(prev, iv, AES_BLOCK_BYTES);
+	while (len)
+	{
+		size = len < sizeof(cc) ? len : sizeof(cc);
+		memcpy(cc, data, size);
+		if (size == sizeof(cc)) DecryptBlocksTable(Ctx, data);
+		else for (i = 0; i < size; i += AES_BLOCK_BYTES) DecryptBlockTable(Ctx, data + i);
+
+		XorBlock(prev, data);
+		for (i = AES_BLOCK_BYTES; i < size; i += AES_BLOCK_BYTES) XorBlock(cc + i - AES_BLOCK_BYTES, data + i);
+		memcpy(prev, cc + size - AES_BLOCK_BYTES, AES_BLOCK_BYTES);
+		data += size; len -= size;
+	}
+}
+
+size_t AesDecryptCbc(const AesCtx* const Ctx, void* _iv, void* _data, size_t len, unsigned threads)
+{
+	uint8_t* data = (uint8_t*)_data;
+	const size_t chunk = 1 << 20;
+	const size_t count = (len + chunk - 1) / chunk;
+	size_t i;
+
+	if (len == 0) return 0;
+
+	// Each chunk chains from the last ciphertext block of the one before it, so keep those before decrypting in place
+	std::vector<uint8_t> ivs(count * AES_BLOCK_BYTES);
+	if (_iv) memcpy(ivs.data(), _iv, AES_BLOCK_BYTES);
+	for (i = 1; i < count; i++) memcpy(&ivs[i * AES_BLOCK_BYTES], data + i * chunk - AES_BLOCK_BYTES, AES_BLOCK_BYTES);
+
+	ParallelFor(count, [&](size_t i) {
+		const size_t size = len - i * chunk < chunk ? len - i * chunk : chunk;
+		DecryptCbc(Ctx, &ivs[i * AES_BLOCK_BYTES], data + i * chunk, size);
+	}, threads);
 
 	return len - *(data + len - 1);
 }
+
+// CTR mode: counter block n is the IV with n added to its last 8 bytes (big endian).
+// The first 8 bytes are used as they are, so nonce and counter are kept in native 64-bit words.
+static void CtrKeystream(const AesCtx* const Ctx, uint64_t nonce, uint64_t counter, uint8_t* ks)
+{
+#ifdef AES_NI_SUPPORTED
+	if (HasAesNi) return CtrKeystreamNi(Ctx, nonce, counter, ks);
+#endif
+	uint64_t block[2];
+	uint8_t j;
+
+	for (j = 0; j < AES_CTR_BLOCKS; j++)
+	{
+		block[0] = nonce; block[1] = Swap64(counter + j);
+		memcpy(ks + j * AES_BLOCK_BYTES, block, AES_BLOCK_BYTES);
+		EncryptBlockTable(Ctx, ks + j * AES_BLOCK_BYTES);
+	}
+}
+
+static void CryptCtr(const AesCtx* const Ctx, const uint8_t* iv, uint8_t* data, size_t len, uint64_t offset)
+{
+	uint8_t ks[AES_BLOCK_BYTES * AES_CTR_BLOCKS];
+	uint64_t nonce, counter, a, b;
+	size_t pos = offset % AES_BLOCK_BYTES, size, i;
+
+	memcpy(&nonce, iv, sizeof(nonce));
+	memcpy(&counter, iv + sizeof(nonce), sizeof(counter));
+	counter = Swap64(counter) + offset / AES_BLOCK_BYTES;
+
+	while (len)
+	{
+		CtrKeystream(Ctx, nonce, counter, ks);
+		size = len < sizeof(ks) - pos ? len : sizeof(ks) - pos;
+		for (i = 0; i + sizeof(a) <= size; i += sizeof(a))
+		{
+			memcpy(&a, data + i, sizeof(a)); memcpy(&b, ks + pos + i, sizeof(b));
+			a ^= b;
+			memcpy(data + i, &a, sizeof(a));
+		}
+		for (; i < size; i++) data[i] ^= ks[pos + i];
+		data += size; len -= size;
+		counter += AES_CTR_BLOCKS; pos = 0;
+	}
+}
+
+size_t AesCryptCtr(const AesCtx* const Ctx, const void* _iv, void* _data, size_t len, uint64_t offset, unsigned threads)
+{
+	const size_t chunk = 1 << 20;
+	uint8_t* data = (uint8_t*)_data;
+
+	ParallelFor((len + chunk - 1) / chunk, [&](size_t i) {
+		const size_t size = len - i * chunk < chunk ? len - i * chunk : chunk;
+		CryptCtr(Ctx, (const uint8_t*)_iv, data + i * chunk, size, offset + i * chunk);
+	}, threads);
+
+	return len;
+}
+
+// GCM (NIST SP 800-38D) with a 96-bit IV and no additional data. GHASH values are kept as
+// two 64-bit halves in the spec's big-endian bit order: hi holds bytes 0-7, lo bytes 8-15.
+#define GCM_ENCRYPT 0
+#define GCM_DECRYPT 1
+#define GCM_VERIFY  2
+
+typedef AesGf128 Gf128;
+typedef AesGcmKey GcmKey;
+
+static inline Gf128 GfLoad(const uint8_t* p)
+{
+	Gf128 r;
+	memcpy(&r.hi, p, sizeof(r.hi)); memcpy(&r.lo, p + sizeof(r.hi), sizeof(r.lo));
+	r.hi = Swap64(r.hi); r.lo = Swap64(r.lo);
+	return r;
+}
+
+static inline void GfStore(Gf128 x, uint8_t* p)
+{
+	x.hi = Swap64(x.hi); x.lo = Swap64(x.lo);
+	memcpy(p, &x.hi, sizeof(x.hi)); memcpy(p + sizeof(x.hi), &x.lo, sizeof(x.lo));
+}
+
+// Bit-at-a-time multiply, only used to combine the per-chunk hashes
+static Gf128 GfMul(Gf128 x, Gf128 y)
+{
+	Gf128 z = { 0, 0 };
+	uint64_t lsb;
+	int i;
+
+	for (i = 0; i < 128; i++)
+	{
+		if (((i < 64 ? x.hi >> (63 - i) : x.lo >> (127 - i)) & 1)) { z.hi ^= y.hi; z.lo ^= y.lo; }
+		lsb = y.lo & 1;
+		y.lo = y.lo >> 1 | y.hi << 63;
+		y.hi = y.hi >> 1 ^ (lsb ? 0xE100000000000000ULL : 0);
+	}
+	return z;
+}
+
+static Gf128 GfPow(Gf128 x, uint64_t n)
+{
+	Gf128 r = { 0x8000000000000000ULL, 0 };
+	for (; n; n >>= 1)
+	{
+		if (n & 1) r = GfMul(r, x);
+		x = GfMul(x, x);
+	}
+	return r;
+}
+
+// 4-bit table (Shoup's method): HH/HL hold H multiplied by every nibble value
+static void GcmInitKey(GcmKey* key, const uint8_t* h)
+{
+	uint64_t vh, vl, lsb;
+	int i, j;
+
+	key->H = GfLoad(h);
+	vh = key->H.hi; vl = key->H.lo;
+	key->HH[0] = key->HL[0] = 0;
+	key->HH[8] = vh; key->HL[8] = vl;
+	for (i = 4; i > 0; i >>= 1)
+	{
+		lsb = vl & 1;
+		vl = vh << 63 | vl >> 1;
+		vh = vh >> 1 ^ (lsb ? 0xE100000000000000ULL : 0);
+		key->HH[i] = vh; key->HL[i] = vl;
+	}
+	for (i = 2; i <= 8; i <<= 1)
+		for (j = 1; j < i; j++)
+		{
+			key->HH[i + j] = key->HH[i] ^ key->HH[j];
+			key->HL[i + j] = key->HL[i] ^ key->HL[j];
+		}
+}
+
+static Gf128 GfMulTable(const GcmKey* key, Gf128 x)
+{
+	static const uint64_t Last4[16] = {
+		0x0000, 0x1c20, 0x3840, 0x2460, 0x7080, 0x6ca0, 0x48c0, 0x54e0,
+		0xe100, 0xfd20, 0xd940, 0xc560, 0x9180, 0x8da0, 0xa9c0, 0xb5e0 };
+	uint64_t zh = 0, zl = 0, rem;
+	uint8_t b, n;
+	int i;
+
+	for (i = 15; i >= 0; i--)
+	{
+		b = (uint8_t)((i < 8 ? x.hi >> (56 - i * 8) : x.lo >> (120 - i * 8)) & 0xff);
+		for (n = 0; n < 2; n++)
+		{
+			if (i != 15 || n)
+			{
+				rem = zl & 0xf;
+				zl = zh << 60 | zl >> 4;
+				zh = zh >> 4 ^ Last4[rem] << 48;
+			}
+			zh ^= key->HH[n ? b >> 4 : b & 0xf];
+			zl ^= key->HL[n ? b >> 4 : b & 0xf];
+		}
+	}
+
+	x.hi = zh; x.lo = zl;
+	return x;
+}
+
+#ifdef AES_NI_SUPPORTED
+// Carry-less multiply of byte-reflected operands followed by the shift-and-reduce from
+// Intel's GCM white paper. A Gf128 maps to such an operand as _mm_set_epi64x(hi, lo).
+AES_CLMUL_TARGET static inline __m128i GfMulNi(__m128i a, __m128i b)
+{
+	__m128i t3, t4, t5, t6, t7, t8, t9;
+
+	t3 = _mm_clmulepi64_si128(a, b, 0x00);
+	t4 = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+	t6 = _mm_clmulepi64_si128(a, b, 0x11);
+	t3 = _mm_xor_si128(t3, _mm_slli_si128(t4, 8));
+	t6 = _mm_xor_si128(t6, _mm_srli_si128(t4, 8));
+
+	t7 = _mm_srli_epi32(t3, 31);
+	t8 = _mm_srli_epi32(t6, 31);
+	t3 = _mm_slli_epi32(t3, 1);
+	t6 = _mm_slli_epi32(t6, 1);
+	t9 = _mm_srli_si128(t7, 12);
+	t8 = _mm_slli_si128(t8, 4);
+	t7 = _mm_slli_si128(t7, 4);
+	t3 = _mm_or_si128(t3, t7);
+	t6 = _mm_or_si128(_mm_or_si128(t6, t8), t9);
+
+	t7 = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(t3, 31), _mm_slli_epi32(t3, 30)), _mm_slli_epi32(t3, 25));
+	t8 = _mm_srli_si128(t7, 4);
+	t3 = _mm_xor_si128(t3, _mm_slli_si128(t7, 12));
+	t5 = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(t3, 1), _mm_srli_epi32(t3, 2)), _mm_srli_epi32(t3, 7));
+	t3 = _mm_xor_si128(t3, _mm_xor_si128(t5, t8));
+	return _mm_xor_si128(t6, t3);
+}
+
+AES_CLMUL_TARGET static inline __m128i GfLoadNi(const uint8_t* p)
+{
+	uint64_t hi, lo;
+	memcpy(&hi, p, sizeof(hi)); memcpy(&lo, p + sizeof(hi), sizeof(lo));
+	return _mm_set_epi64x((long long)Swap64(hi), (long long)Swap64(lo));
+}
+
+// Four blocks per step against H^4..H^1, so the multiplies are independent of each other
+AES_CLMUL_TARGET static Gf128 GhashNi(const GcmKey* key, Gf128 y, const uint8_t* data, size_t blocks)
+{
+	__m128i h[4], x = _mm_set_epi64x((long long)y.hi, (long long)y.lo);
+	size_t i;
+	int j;
+
+	h[0] = _mm_set_epi64x((long long)key->H.hi, (long long)key->H.lo);
+	for (j = 1; j < 4; j++) h[j] = GfMulNi(h[j - 1], h[0]);
+
+	for (i = 0; i + 4 <= blocks; i += 4, data += AES_BLOCK_BYTES * 4)
+	{
+		x = _mm_xor_si128(
+			_mm_xor_si128(GfMulNi(_mm_xor_si128(x, GfLoadNi(data)), h[3]), GfMulNi(GfLoadNi(data + AES_BLOCK_BYTES), h[2])),
+			_mm_xor_si128(GfMulNi(GfLoadNi(data + AES_BLOCK_BYTES * 2), h[1]), GfMulNi(GfLoadNi(data + AES_BLOCK_BYTES * 3), h[0])));
+	}
+	for (; i < blocks; i++, data += AES_BLOCK_BYTES) x = GfMulNi(_mm_xor_si128(x, GfLoadNi(data)), h[0]);
+
+	memcpy(&y.lo, &x, sizeof(y.lo)); memcpy(&y.hi, (uint8_t*)&x + sizeof(y.lo), sizeof(y.hi));
+	return y;
+}
+#endif
+
+// GHASH of len bytes continuing from y; a trailing partial block is zero padded
+static Gf128 Ghash(const GcmKey* key, Gf128 y, const uint8_t* data, size_t len)
+{
+	const size_t blocks = len / AES_BLOCK_BYTES;
+	uint8_t last[AES_BLOCK_BYTES] = { 0 };
+	Gf128 x;
+	size_t i;
+
+#ifdef AES_NI_SUPPORTED
+	if (HasClmul) y = GhashNi(key, y, data, blocks);
+	else
+#endif
+	for (i = 0; i < blocks; i++)
+	{
+		x = GfLoad(data + i * AES_BLOCK_BYTES);
+		y.hi ^= x.hi; y.lo ^= x.lo;
+		y = GfMulTable(key, y);
+	}
+
+	if (len % AES_BLOCK_BYTES)
+	{
+		memcpy(last, data + blocks * AES_BLOCK_BYTES, len % AES_BLOCK_BYTES);
+		x = GfLoad(last);
+		y.hi ^= x.hi; y.lo ^= x.lo;
+		y = GfMulTable(key, y);
+	}
+	return y;
+}
+
+static void GcmHash(AesStream* s, const uint8_t* data, size_t len)
+{
+	s->Hash = Ghash(&s->Gcm, s->Hash, data, len);
+	s->Hashed += len;
+}
+
+// Streams process a message in pieces from any 16-byte aligned offset, so a caller can encrypt
+// or decrypt data while it is still in cache and split one message across threads.
+// For CBC at a nonzero offset, prev is the ciphertext block just before it.
+void AesStreamInit(AesStream* s, const AesCtx* const Ctx, uint8_t mode, bool decrypt, const void* _iv, uint64_t offset, const void* _prev)
+{
+	uint8_t h[AES_BLOCK_BYTES] = { 0 };
+
+	memset(s, 0, sizeof(*s));
+	s->Ctx = Ctx;
+	s->Mode = mode;
+	s->Decrypt = decrypt;
+	s->Offset = offset;
+
+	if (mode == AES_MODE_CBC)
+	{
+		if (offset) memcpy(s->Iv, _prev, AES_BLOCK_BYTES);
+		else if (_iv) memcpy(s->Iv, _iv, AES_BLOCK_BYTES);
+	}
+	else if (mode == AES_MODE_CTR) memcpy(s->Iv, _iv, AES_BLOCK_BYTES);
+	else
+	{
+		// Data starts at counter 2; counter 1 (J0) is kept for the tag
+		memcpy(s->Iv, _iv, 12);
+		s->Iv[15] = 2;
+		AesEncryptBlock(Ctx, h);
+		GcmInitKey(&s->Gcm, h);
+	}
+}
+
+// len must be a multiple of 16 except for the last piece of a CTR or GCM message. in may equal out.
+void AesStreamUpdate(AesStream* s, const void* _in, void* _out, size_t len)
+{
+	const uint8_t* in = (const uint8_t*)_in;
+	uint8_t* out = (uint8_t*)_out;
+	uint8_t last[AES_BLOCK_BYTES];
+
+	if (len == 0) return;
+
+	if (s->Mode == AES_MODE_CBC)
+	{
+		memcpy(last, in + len - AES_BLOCK_BYTES, AES_BLOCK_BYTES);
+		if (in != out) memmove(out, in, len);
+		if (s->Decrypt) DecryptCbc(s->Ctx, s->Iv, out, len);
+		else EncryptCbc(s->Ctx, s->Iv, out, len);
+		memcpy(s->Iv, s->Decrypt ? last : out + len - AES_BLOCK_BYTES, AES_BLOCK_BYTES);
+	}
+	else
+	{
+		if (s->Mode == AES_MODE_GCM && s->Decrypt) GcmHash(s, in, len);
+		if (in != out) memmove(out, in, len);
+		CryptCtr(s->Ctx, s->Iv, out, len, s->Offset);
+		if (s->Mode == AES_MODE_GCM && !s->Decrypt) GcmHash(s, out, len);
+	}
+	s->Offset += len;
+}
+
+// Pads and encrypts the remaining len bytes for CBC (data needs room for one more block).
+// Returns the length written.
+size_t AesStreamFinish(AesStream* s, void* _data, size_t len)
+{
+	uint8_t* data = (uint8_t*)_data;
+	uint8_t pad;
+
+	if (s->Mode == AES_MODE_CBC && !s->Decrypt)
+	{
+		pad = (~len & (AES_BLOCK_BYTES - 1)) + 1;
+		memset(data + len, pad, pad);
+		len += pad;
+	}
+	AesStreamUpdate(s, data, data, len);
+	return len;
+}
+
+// Appends next, which must start where s ends, as if s had processed its data too
+void AesStreamJoin(AesStream* s, const AesStream* next)
+{
+	if (s->Mode == AES_MODE_GCM)
+	{
+		s->Hash = GfMul(s->Hash, GfPow(s->Gcm.H, (next->Hashed + AES_BLOCK_BYTES - 1) / AES_BLOCK_BYTES));
+		s->Hash.hi ^= next->Hash.hi; s->Hash.lo ^= next->Hash.lo;
+		s->Hashed += next->Hashed;
+	}
+	memcpy(s->Iv, next->Iv, AES_BLOCK_BYTES);
+	s->Offset = next->Offset;
+}
+
+// GCM tag of everything s (started at offset 0) has processed
+void AesStreamTag(const AesStream* s, void* _tag)
+{
+	uint8_t* tag = (uint8_t*)_tag;
+	uint8_t j0[AES_BLOCK_BYTES];
+	Gf128 y = s->Hash;
+	int i;
+
+	y.lo ^= s->Hashed * 8;
+	y = GfMulTable(&s->Gcm, y);
+	GfStore(y, tag);
+
+	memcpy(j0, s->Iv, AES_BLOCK_BYTES);
+	j0[15] = 1;
+	AesEncryptBlock(s->Ctx, j0);
+	for (i = 0; i < AES_BLOCK_BYTES; i++) tag[i] ^= j0[i];
+}
+
+// Each 1 MB chunk gets its own stream and is encrypted and hashed while it is still in cache.
+// The counter is carried in 64 bits by CryptCtr, which only differs from the spec's 32-bit
+// increment past 2^32 blocks (64 GB), beyond what GCM allows under one IV anyway.
+static bool CryptGcm(const AesCtx* const Ctx, const uint8_t* iv, uint8_t* data, size_t len, uint8_t* tag, int mode, unsigned threads)
+{
+	const size_t chunk = 1 << 20;
+	const size_t count = (len + chunk - 1) / chunk;
+	std::vector<AesStream> parts(count ? count : 1);
+	uint8_t mac[AES_BLOCK_BYTES], diff = 0;
+	size_t i;
+
+	AesStreamInit(&parts[0], Ctx, AES_MODE_GCM, mode != GCM_ENCRYPT, iv);
+	ParallelFor(count, [&](size_t i) {
+		uint8_t* p = data + i * chunk;
+		const size_t size = len - i * chunk < chunk ? len - i * chunk : chunk;
+		if (i) AesStreamInit(&parts[i], Ctx, AES_MODE_GCM, mode != GCM_ENCRYPT, iv, i * chunk);
+		if (mode != GCM_VERIFY) AesStreamUpdate(&parts[i], p, p, size);
+		else
+		{
+			GcmHash(&parts[i], p, size);
+			parts[i].Offset += size;
+		}
+	}, threads);
+
+	for (i = 1; i < count; i++) AesStreamJoin(&parts[0], &parts[i]);
+	AesStreamTag(&parts[0], mac);
+
+	if (mode == GCM_ENCRYPT)
+	{
+		memcpy(tag, mac, AES_BLOCK_BYTES);
+		return true;
+	}
+	for (i = 0; i < AES_BLOCK_BYTES; i++) diff |= mac[i] ^ tag[i];
+	return diff == 0;
+}
+
+void AesEncryptGcm(const AesCtx* const Ctx, const void* _iv, void* _data, size_t len, void* _tag, unsigned threads)
+{
+	CryptGcm(Ctx, (const uint8_t*)_iv, (uint8_t*)_data, len, (uint8_t*)_tag, GCM_ENCRYPT, threads);
+}
+
+bool AesDecryptGcm(const AesCtx* const Ctx, const void* _iv, void* _data, size_t len, const void* _tag, unsigned threads)
+{
+	return CryptGcm(Ctx, (const uint8_t*)_iv, (uint8_t*)_data, len, (uint8_t*)_tag, GCM_DECRYPT, threads);
+}
+
+bool AesVerifyGcm(const AesCtx* const Ctx, const void* _iv, const void* _data, size_t len, const void* _tag, unsigned threads)
+{
+	return CryptGcm(Ctx, (const uint8_t*)_iv, (uint8_t*)_data, len, (uint8_t*)_tag, GCM_VERIFY, threads);
+}
+
+// FIPS-197 key expansion. AesInitKey rotates the other way and puts RCon in the top byte,
+// so archive keys do not match the standard schedule; this one is only used for the vectors.
+static void AesInitKeyFips(AesCtx* Ctx, const uint8_t* Key, int KeyBytes)
+{
+	int KeyDwords = KeyBytes / sizeof(uint32_t);
+	Ctx->rounds = (uint8_t)(KeyDwords + 6);
+
+	uint8_t i, rcon = 1;
+	uint32_t temp;
+
+	memcpy(Ctx->Key, Key, KeyBytes);
+
+	for (i = (uint8_t)KeyDwords; i < (Ctx->rounds + 1) << 2; i++)
+	{
+		temp = Ctx->Key[i - 1];
+
+		if ((i % KeyDwords) == 0)
+		{
+			temp = SubDword(ROR32(temp, 8)) ^ rcon;
+			rcon = (uint8_t)Mul2((uint32_t)rcon);
+		}
+		else if (KeyDwords > 6 && (i % KeyDwords) == 4) temp = SubDword(temp);
+
+		Ctx->Key[i] = Ctx->Key[i - KeyDwords] ^ temp;
+	}
+
+	AesInitKeyR(Ctx);
+}
+
+bool AesSelfTest()
+{
+	// FIPS-197 Appendix C.1 - C.3
+	static const uint8_t Expected[3][AES_BLOCK_BYTES] = {
+		{ 0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A },
+		{ 0xDD, 0xA9, 0x7C, 0xA4, 0x86, 0x4C, 0xDF, 0xE0, 0x6E, 0xAF, 0x70, 0xA0, 0xEC, 0x0D, 0x71, 0x91 },
+		{ 0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF, 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89 } };
+
+	typedef void (*BlockFunc)(const AesCtx* const, void*);
+	static const BlockFunc Encrypt[] = { EncryptBlockTable, AesEncryptBlock };
+	static const BlockFunc Decrypt[] = { DecryptBlockTable, AesDecryptBlock };
+
+	uint8_t key[32], plain[AES_BLOCK_BYTES], ref[AES_BLOCK_BYTES], fast[AES_BLOCK_BYTES];
+	AesCtx ctx;
+	int i, n, m;
+
+	for (i = 0; i < 32; i++) key[i] = (uint8_t)i;
+	for (i = 0; i < AES_BLOCK_BYTES; i++) plain[i] = (uint8_t)(i * 0x11);
+
+	for (n = 0; n < 3; n++)
+	{
+		AesInitKeyFips(&ctx, key, 16 + n * 8);
+		memcpy(ref, plain, AES_BLOCK_BYTES); AesEncryptBlockRef(&ctx, ref);
+		if (memcmp(ref, Expected[n], AES_BLOCK_BYTES)) return false;
+		AesDecryptBlockRef(&ctx, ref);
+		if (memcmp(ref, plain, AES_BLOCK_BYTES)) return false;
+
+		for (m = 0; m < 2; m++)
+		{
+			memcpy(fast, plain, AES_BLOCK_BYTES); Encrypt[m](&ctx, fast);
+			if (memcmp(fast, Expected[n], AES_BLOCK_BYTES)) return false;
+			Decrypt[m](&ctx, fast);
+			if (memcmp(fast, plain, AES_BLOCK_BYTES)) return false;
+		}
+	}
+
+	// GCM test case 3 (AES-128, 96-bit IV, 64 bytes, no additional data)
+	static const uint8_t GcmKey3[16] = { 0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c, 0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08 };
+	static const uint8_t GcmIv3[12] = { 0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad, 0xde, 0xca, 0xf8, 0x88 };
+	static const uint8_t GcmPlain3[64] = {
+		0xd9, 0x31, 0x32, 0x25, 0xf8, 0x84, 0x06, 0xe5, 0xa5, 0x59, 0x09, 0xc5, 0xaf, 0xf5, 0x26, 0x9a,
+		0x86, 0xa7, 0xa9, 0x53, 0x15, 0x34, 0xf7, 0xda, 0x2e, 0x4c, 0x30, 0x3d, 0x8a, 0x31, 0x8a, 0x72,
+		0x1c, 0x3c, 0x0c, 0x95, 0x95, 0x68, 0x09, 0x53, 0x2f, 0xcf, 0x0e, 0x24, 0x49, 0xa6, 0xb5, 0x25,
+		0xb1, 0x6a, 0xed, 0xf5, 0xaa, 0x0d, 0xe6, 0x57, 0xba, 0x63, 0x7b, 0x39, 0x1a, 0xaf, 0xd2, 0x55 };
+	static const uint8_t GcmCipher3[64] = {
+		0x42, 0x83, 0x1e, 0xc2, 0x21, 0x77, 0x74, 0x24, 0x4b, 0x72, 0x21, 0xb7, 0x84, 0xd0, 0xd4, 0x9c,
+		0xe3, 0xaa, 0x21, 0x2f, 0x2c, 0x02, 0xa4, 0xe0, 0x35, 0xc1, 0x7e, 0x23, 0x29, 0xac, 0xa1, 0x2e,
+		0x21, 0xd5, 0x14, 0xb2, 0x54, 0x66, 0x93, 0x1c, 0x7d, 0x8f, 0x6a, 0x5a, 0xac, 0x84, 0xaa, 0x05,
+		0x1b, 0xa3, 0x0b, 0x39, 0x6a, 0x0a, 0xac, 0x97, 0x3d, 0x58, 0xe0, 0x91, 0x47, 0x3f, 0x59, 0x85 };
+	static const uint8_t GcmTag3[16] = { 0x4d, 0x5c, 0x2a, 0xf3, 0x27, 0xcd, 0x64, 0xa6, 0x2c, 0xf3, 0x5a, 0xbd, 0x2b, 0xa6, 0xfa, 0xb4 };
+	uint8_t gcm[64], tag[AES_BLOCK_BYTES];
+
+	AesInitKeyFips(&ctx, GcmKey3, 16);
+	memcpy(gcm, GcmPlain3, sizeof(gcm));
+	AesEncryptGcm(&ctx, GcmIv3, gcm, sizeof(gcm), tag, 1);
+	if (memcmp(gcm, GcmCipher3, sizeof(gcm)) || memcmp(tag, GcmTag3, sizeof(tag))) return false;
+	if (!AesVerifyGcm(&ctx, GcmIv3, gcm, sizeof(gcm), tag, 1)) return false;
+	gcm[63] ^= 1;
+	if (AesVerifyGcm(&ctx, GcmIv3, gcm, sizeof(gcm), tag, 1)) return false;
+
+	// Both implementations must also agree on the archive key schedule
+	for (n = 0; n < 64; n++)
+	{
+		for (i = 0; i < 32; i++) key[i] = (uint8_t)(key[i] * 31 + n);
+		for (i = 0; i < AES_BLOCK_BYTES; i++) plain[i] = (uint8_t)(plain[i] * 17 + n);
+		AesInitKey(&ctx, key, 32);
+		memcpy(ref, plain, AES_BLOCK_BYTES); AesEncryptBlockRef(&ctx, ref);
+
+		for (m = 0; m < 2; m++)
+		{
+			memcpy(fast, plain, AES_BLOCK_BYTES); Encrypt[m](&ctx, fast);
+			if (memcmp(ref, fast, AES_BLOCK_BYTES)) return false;
+			Decrypt[m](&ctx, fast);
+			if (memcmp(fast, plain, AES_BLOCK_BYTES)) return false;
+		}
+	}
+
+	return true;
+}
@@ -7,13 +7,51 @@
 constexpr auto AES_BLOCK_BYTES = 16;
 constexpr auto AES_BLOCK_WORDS = AES_BLOCK_BYTES / sizeof(uint32_t);
 
+constexpr uint8_t AES_MODE_CBC = 1;
+constexpr uint8_t AES_MODE_CTR = 2;
+constexpr uint8_t AES_MODE_GCM = 3;
+
 typedef struct {
 	uint32_t Key[60];
+	uint32_t KeyR[60];
 	uint8_t rounds;
 } AesCtx;
 
+typedef struct {
+	uint64_t hi, lo;
+} AesGf128;
+
+typedef struct {
+	AesGf128 H;
+	uint64_t HL[16], HH[16];
+} AesGcmKey;
+
+typedef struct {
+	const AesCtx* Ctx;
+	AesGcmKey Gcm;
+	AesGf128 Hash;
+	uint64_t Hashed;
+	uint64_t Offset;
+	uint8_t Iv[AES_BLOCK_BYTES];
+	uint8_t Mode;
+	bool Decrypt;
+} AesStream;
+
 void AesInitKey(AesCtx* Ctx, const uint8_t* Key, int AesKeyBytes);
 void AesEncryptBlock(const AesCtx* const Ctx, void* _block);
 void AesDecryptBlock(const AesCtx* const Ctx, void* _block);
+void AesEncryptBlockRef(const AesCtx* const Ctx, void* _block);
+void AesDecryptBlockRef(const AesCtx* const Ctx, void* _block);
 size_t AesEncryptCbc(const AesCtx* const Ctx, void* _iv, void* _data, size_t len);
-size_t AesDecryptCbc(const AesCtx* const Ctx, void* _iv, void* _data, size_t len);
+size_t AesDecryptCbc(const AesCtx* const Ctx, void* _iv, void* _data, size_t len, unsigned threads = 0);
+size_t AesCryptCtr(const AesCtx* const Ctx, const void* _iv, void* _data, size_t len, uint64_t offset = 0, unsigned threads = 0);
+void AesEncryptGcm(const AesCtx* const Ctx, const void* _iv, void* _data, size_t len, void* _tag, unsigned threads = 0);
+bool AesDecryptGcm(const AesCtx* const Ctx, const void* _iv, void* _data, size_t len, const void* _tag, unsigned threads = 0);
+bool AesVerifyGcm(const AesCtx* const Ctx, const void* _iv, const void* _data, size_t len, const void* _tag, unsigned threads = 0);
+void AesStreamInit(AesStream* s, const AesCtx* const Ctx, uint8_t mode, bool decrypt, const void* _iv, uint64_t offset = 0, const void* _prev = nullptr);
+void AesStreamUpdate(AesStream* s, const void* _in, void* _out, size_t len);
+size_t AesStreamFinish(AesStream* s, void* _data, size_t len);
+void AesStreamJoin(AesStream* s, const AesStream* next);
+void AesStreamTag(const AesStream* s, void* _tag);
+bool AesSelfTest();
+bool AesIsAccelerated();
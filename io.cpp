@@ -0,0 +1,611 @@
+#include "io.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define IO_URING_SUPPORTED
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+struct IO_FILE {
+#ifdef _WIN32
+	HANDLE handle;
+#else
+	int fd;
+#endif
+	bool direct;
+};
+
+// xɓn傫iDWORDssize_tɎ܂悤Ɂj
+constexpr size_t IO_CHUNK = (size_t)1 << 30;
+
+#ifdef _WIN32
+IO_FILE* IoOpen(const std::filesystem::path& path, bool write, bool direct)
+{
+	const DWORD access = write ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+	const DWORD create = write ? CREATE_ALWAYS : OPEN_EXISTING;
+	HANDLE handle = CreateFileW(path.c_str(), access, FILE_SHARE_READ, nullptr, create, FILE_ATTRIBUTE_NORMAL | (direct ? FILE_FLAG_NO_BUFFERING : 0), nullptr);
+	if (handle == INVALID_HANDLE_VALUE && direct)
+	{
+		direct = false;
+		handle = CreateFileW(path.c_str(), access, FILE_SHARE_READ, nullptr, create, FILE_ATTRIBUTE_NORMAL, nullptr);
+	}
+	if (handle == INVALID_HANDLE_VALUE) return nullptr;
+	return new IO_FILE{ handle, direct };
+}
+
+void IoClose(IO_FILE* file)
+{
+	if (!file) return;
+	CloseHandle(file->handle);
+	delete file;
+}
+
+uint64_t IoSize(const IO_FILE* file)
+{
+	LARGE_INTEGER size;
+	return GetFileSizeEx(file->handle, &size) ? (uint64_t)size.QuadPart : 0;
+}
+
+bool IoRead(IO_FILE* file, void* data, size_t len, uint64_t offset)
+{
+	for (size_t done = 0; done < len;)
+	{
+		OVERLAPPED ov{};
+		ov.Offset = (DWORD)(offset + done);
+		ov.OffsetHigh = (DWORD)((offset + done) >> 32);
+		DWORD n = 0;
+		if (!ReadFile(file->handle, (uint8_t*)data + done, (DWORD)std::min(len - done, IO_CHUNK), &n, &ov) || n == 0) return false;
+		done += n;
+	}
+	return true;
+}
+
+bool IoWrite(IO_FILE* file, const void* data, size_t len, uint64_t offset)
+{
+	for (size_t done = 0; done < len;)
+	{
+		OVERLAPPED ov{};
+		ov.Offset = (DWORD)(offset + done);
+		ov.OffsetHigh = (DWORD)((offset + done) >> 32);
+		DWORD n = 0;
+		if (!WriteFile(file->handle, (const uint8_t*)data + done, (DWORD)std::min(len - done, IO_CHUNK), &n, &ov) || n == 0) return false;
+		done += n;
+	}
+	return true;
+}
+
+bool IoTruncate(IO_FILE* file, uint64_t size)
+{
+	FILE_END_OF_FILE_INFO info;
+	info.EndOfFile.QuadPart = (LONGLONG)size;
+	return SetFileInformationByHandle(file->handle, FileEndOfFileInfo, &info, sizeof(info)) != 0;
+}
+
+bool IoAllocate(IO_FILE* file, uint64_t size)
+{
+	FILE_ALLOCATION_INFO info;
+	info.AllocationSize.QuadPart = (LONGLONG)size;
+	return SetFileInformationByHandle(file->handle, FileAllocationInfo, &info, sizeof(info)) != 0;
+}
+
+bool IoSetSparse(IO_FILE* file)
+{
+	DWORD n = 0;
+	return DeviceIoControl(file->handle, FSCTL_SET_SPARSE, nullptr, 0, nullptr, 0, &n, nullptr) != 0;
+}
+
+void IoAdvise(IO_FILE*, uint64_t, uint64_t, IO_ADVICE)
+{
+	// Windowsł͊JƂ̃tOłwłȂ
+}
+
+void* IoAlloc(size_t size)
+{
+	return _aligned_malloc(size ? size : 1, IO_ALIGN);
+}
+
+void IoFree(void* data)
+{
+	_aligned_free(data);
+}
+#else
+IO_FILE* IoOpen(const std::filesystem::path& path, bool write, bool direct)
+{
+	const int flags = (write ? O_RDWR | O_CREAT | O_TRUNC : O_RDONLY) | O_CLOEXEC;
+	int fd = -1;
+#ifdef O_DIRECT
+	// tmpfsȂO_DIRECTɑΉĂȂt@CVXełEINVALɂȂ
+	if (direct) fd = open(path.c_str(), flags | O_DIRECT, 0644);
+#endif
+	if (fd < 0)
+	{
+		fd = open(path.c_str(), flags, 0644);
+#ifdef F_NOCACHE
+		if (fd >= 0 && direct) fcntl(fd, F_NOCACHE, 1);
+#else
+		direct = false;
+#endif
+	}
+	if (fd < 0) return nullptr;
+	return new IO_FILE{ fd, direct };
+}
+
+void IoClose(IO_FILE* file)
+{
+	if (!file) return;
+	close(file->fd);
+	delete file;
+}
+
+uint64_t IoSize(const IO_FILE* file)
+{
+	struct stat st;
+	return fstat(file->fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+bool IoRead(IO_FILE* file, void* data, size_t len, uint64_t offset)
+{
+	for (size_t done = 0; done < len;)
+	{
+		const ssize_t n = pread(file->fd, (uint8_t*)data + done, std::min(len - done, IO_CHUNK), (off_t)(offset + done));
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR) continue;
+			return false;
+		}
+		done += (size_t)n;
+	}
+	return true;
+}
+
+bool IoWrite(IO_FILE* file, const void* data, size_t len, uint64_t offset)
+{
+	for (size_t done = 0; done < len;)
+	{
+		const ssize_t n = pwrite(file->fd, (const uint8_t*)data + done, std::min(len - done, IO_CHUNK), (off_t)(offset + done));
+		if (n <= 0)
+		{
+			if (n < 0 && errno == EINTR) continue;
+			return false;
+		}
+		done += (size_t)n;
+	}
+	return true;
+}
+
+bool IoTruncate(IO_FILE* file, uint64_t size)
+{
+	return ftruncate(file->fd, (off_t)size) == 0;
+}
+
+bool IoAllocate(IO_FILE* file, uint64_t size)
+{
+#ifdef __linux__
+	// posix_fallocate͑ΉĂȂt@CVXe0ł܂̂ŎgȂ
+	return size == 0 || fallocate(file->fd, FALLOC_FL_KEEP_SIZE, 0, (off_t)size) == 0;
+#else
+	(void)file; (void)size;
+	return false;
+#endif
+}
+
+bool IoSetSparse(IO_FILE*)
+{
+	// POSIX̃t@CVXe͏łȂŏ猊ƂĈ
+	return true;
+}
+
+void IoAdvise(IO_FILE* file, uint64_t offset, uint64_t len, IO_ADVICE advice)
+{
+#ifdef POSIX_FADV_SEQUENTIAL
+	const int table[] = { POSIX_FADV_SEQUENTIAL, POSIX_FADV_WILLNEED, POSIX_FADV_DONTNEED };
+	posix_fadvise(file->fd, (off_t)offset, (off_t)len, table[advice]);
+#else
+	(void)file; (void)offset; (void)len; (void)advice;
+#endif
+}
+
+void* IoAlloc(size_t size)
+{
+	void* data = nullptr;
+	return posix_memalign(&data, IO_ALIGN, size ? size : 1) == 0 ? data : nullptr;
+}
+
+void IoFree(void* data)
+{
+	free(data);
+}
+#endif
+
+bool IoIsDirect(const IO_FILE* file)
+{
+	return file->direct;
+}
+
+bool IoCopy(IO_FILE* in, uint64_t in_offset, IO_FILE* out, uint64_t out_offset, uint64_t len)
+{
+#ifdef __linux__
+	// ʂ̃t@CVXemÂJ[lł͎ŝŁAobt@ŃRs[
+	loff_t src = (loff_t)in_offset, dst = (loff_t)out_offset;
+	while (len)
+	{
+		const ssize_t n = copy_file_range(in->fd, &src, out->fd, &dst, (size_t)std::min<uint64_t>(len, IO_CHUNK), 0);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) break;
+		len -= (uint64_t)n;
+	}
+	if (len == 0) return true;
+	in_offset = (uint64_t)src;
+	out_offset = (uint64_t)dst;
+#endif
+	const size_t size = (size_t)std::min<uint64_t>(len, IO_BUFFER_SIZE);
+	uint8_t* buffer = (uint8_t*)IoAlloc(size);
+	bool result = buffer != nullptr;
+	for (uint64_t done = 0; result && done < len; done += size)
+	{
+		const size_t n = (size_t)std::min<uint64_t>(len - done, size);
+		result = IoRead(in, buffer, n, in_offset + done) && IoWrite(out, buffer, n, out_offset + done);
+	}
+	IoFree(buffer);
+	return result;
+}
+
+void IoReaderInit(IO_READER* r, IO_FILE* file, uint64_t offset, size_t size)
+{
+	r->file = file;
+	r->offset = offset;
+	r->size = std::max<size_t>(size, IO_ALIGN);
+	r->buffer = (uint8_t*)IoAlloc(r->size);
+	r->pos = r->len = 0;
+}
+
+bool IoReaderRead(IO_READER* r, void* data, size_t len)
+{
+	uint8_t* out = (uint8_t*)data;
+	while (len)
+	{
+		if (r->pos == r->len)
+		{
+			// obt@傫͒ړǂ
+			r->offset += r->len;
+			r->pos = r->len = 0;
+			if (len >= r->size)
+			{
+				if (!IoRead(r->file, out, len, r->offset)) return false;
+				r->offset += len;
+				return true;
+			}
+			const uint64_t size = IoSize(r->file);
+			if (r->offset >= size) return false;
+			r->len = (size_t)std::min<uint64_t>(r->size, size - r->offset);
+			if (!IoRead(r->file, r->buffer, r->len, r->offset)) return false;
+		}
+		const size_t n = std::min(len, r->len - r->pos);
+		memcpy(out, r->buffer + r->pos, n);
+		r->pos += n; out += n; len -= n;
+	}
+	return true;
+}
+
+uint64_t IoReaderTell(const IO_READER* r)
+{
+	return r->offset + r->pos;
+}
+
+void IoReaderFree(IO_READER* r)
+{
+	IoFree(r->buffer);
+	r->buffer = nullptr;
+}
+
+void IoWriterInit(IO_WRITER* w, IO_FILE* file, uint64_t offset, size_t size)
+{
+	w->file = file;
+	w->offset = IoIsDirect(file) ? offset / IO_ALIGN * IO_ALIGN : offset;
+	w->size = std::max<size_t>((size + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN, IO_ALIGN);
+	w->buffer = (uint8_t*)IoAlloc(w->size);
+	w->len = (size_t)(offset - w->offset);
+	w->failed = w->buffer == nullptr;
+	if (w->buffer) memset(w->buffer, 0, w->len);
+}
+
+bool IoWriterWrite(IO_WRITER* w, const void* data, size_t len)
+{
+	if (!w->failed && w->len + len > w->size && !IoIsDirect(w->file))
+	{
+		w->failed = (w->len && !IoWrite(w->file, w->buffer, w->len, w->offset)) || !IoWrite(w->file, data, len, w->offset + w->len);
+		w->offset += w->len + len;
+		w->len = 0;
+		return !w->failed;
+	}
+
+	const uint8_t* in = (const uint8_t*)data;
+	while (len && !w->failed)
+	{
+		const size_t n = std::min(len, w->size - w->len);
+		memcpy(w->buffer + w->len, in, n);
+		w->len += n; in += n; len -= n;
+		if (w->len < w->size) break;
+		if (!IoWrite(w->file, w->buffer, w->size, w->offset)) w->failed = true;
+		w->offset += w->size;
+		w->len = 0;
+	}
+	return !w->failed;
+}
+
+bool IoWriterFinish(IO_WRITER* w)
+{
+	if (!w->failed && w->len)
+	{
+		const uint64_t end = w->offset + w->len;
+		if (IoIsDirect(w->file))
+		{
+			const size_t padded = (w->len + IO_ALIGN - 1) / IO_ALIGN * IO_ALIGN;
+			memset(w->buffer + w->len, 0, padded - w->len);
+			w->failed = !IoWrite(w->file, w->buffer, padded, w->offset) || (padded != w->len && !IoTruncate(w->file, end));
+		}
+		else w->failed = !IoWrite(w->file, w->buffer, w->len, w->offset);
+		w->offset = end;
+		w->len = 0;
+	}
+	IoFree(w->buffer);
+	w->buffer = nullptr;
+	return !w->failed;
+}
+
+
+struct IO_REQUEST {
+	IO_FILE* file;
+	uint8_t* data;
+	size_t len, done;
+	uint64_t offset, tag;
+	bool write;
+#ifdef IO_URING_SUPPORTED
+	iovec iov;
+#endif
+};
+
+struct IO_QUEUE {
+	std::vector<IO_REQUEST> requests;
+	std::vector<size_t> free;	// 󂢂Ărequests̔ԍ
+	std::deque<size_t> pending;	// io_uringgȂƂɁAIoQueueWaitŏɏv
+#ifdef IO_URING_SUPPORTED
+	int ring;
+	void* sq_ptr; void* cq_ptr; io_uring_sqe* sqes;
+	size_t sq_size, cq_size, sqes_size;
+	unsigned* sq_tail; unsigned* sq_array; unsigned sq_mask;
+	unsigned* cq_head; unsigned* cq_tail; unsigned cq_mask; io_uring_cqe* cqes;
+	unsigned unsubmitted;
+#endif
+};
+
+#ifdef IO_URING_SUPPORTED
+static bool RingInit(IO_QUEUE* q, unsigned depth)
+{
+	io_uring_params p{};
+	q->ring = (int)syscall(__NR_io_uring_setup, depth, &p);
+	if (q->ring < 0) return false;
+
+	q->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	q->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+	q->sqes_size = p.sq_entries * sizeof(io_uring_sqe);
+	const bool single = p.features & IORING_FEAT_SINGLE_MMAP;
+	if (single) q->sq_size = q->cq_size = std::max(q->sq_size, q->cq_size);
+
+	q->sq_ptr = mmap(nullptr, q->sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->ring, IORING_OFF_SQ_RING);
+	q->cq_ptr = single ? q->sq_ptr : mmap(nullptr, q->cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->ring, IORING_OFF_CQ_RING);
+	void* sqes = mmap(nullptr, q->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, q->ring, IORING_OFF_SQES);
+	if (q->sq_ptr == MAP_FAILED || q->cq_ptr == MAP_FAILED || sqes == MAP_FAILED)
+	{
+		if (q->sq_ptr != MAP_FAILED) munmap(q->sq_ptr, q->sq_size);
+		if (!single && q->cq_ptr != MAP_FAILED) munmap(q->cq_ptr, q->cq_size);
+		if (sqes != MAP_FAILED) munmap(sqes, q->sqes_size);
+		close(q->ring);
+		q->ring = -1;
+		return false;
+	}
+
+	uint8_t* sq = (uint8_t*)q->sq_ptr;
+	uint8_t* cq = (uint8_t*)q->cq_ptr;
+	q->sqes = (io_uring_sqe*)sqes;
+	q->sq_tail = (unsigned*)(sq + p.sq_off.tail);
+	q->sq_array = (unsigned*)(sq + p.sq_off.array);
+	q->sq_mask = *(unsigned*)(sq + p.sq_off.ring_mask);
+	q->cq_head = (unsigned*)(cq + p.cq_off.head);
+	q->cq_tail = (unsigned*)(cq + p.cq_off.tail);
+	q->cq_mask = *(unsigned*)(cq + p.cq_off.ring_mask);
+	q->cqes = (io_uring_cqe*)(cq + p.cq_off.cqes);
+	q->unsubmitted = 0;
+	return true;
+}
+
+// v̎c̕SQɐςށBv̐SQ̑傫ȉȂ̂łӂȂ
+static void RingPush(IO_QUEUE* q, size_t slot)
+{
+	IO_REQUEST& r = q->requests[slot];
+	r.iov.iov_base = r.data + r.done;
+	r.iov.iov_len = std::min(r.len - r.done, IO_CHUNK);
+
+	const unsigned tail = *q->sq_tail;
+	const unsigned index = tail & q->sq_mask;
+	io_uring_sqe* sqe = &q->sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = r.write ? IORING_OP_WRITEV : IORING_OP_READV;
+	sqe->fd = r.file->fd;
+	sqe->addr = (uint64_t)(uintptr_t)&r.iov;
+	sqe->len = 1;
+	sqe->off = r.offset + r.done;
+	sqe->user_data = slot;
+	q->sq_array[index] = index;
+	__atomic_store_n(q->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	q->unsubmitted++;
+}
+
+// ߂lSQoꂽAsƂ-errno
+static int RingEnter(IO_QUEUE* q, unsigned wait)
+{
+	const int ret = (int)syscall(__NR_io_uring_enter, q->ring, q->unsubmitted, wait, wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+	if (ret < 0) return -errno;
+	q->unsubmitted -= std::min((unsigned)ret, q->unsubmitted);
+	return ret;
+}
+
+// 荞܂ꂽƂJ[l̎ꎞIɑȂƂAxĂׂ΂悢
+static bool RingRetry(int ret)
+{
+	return ret >= 0 || ret == -EINTR || ret == -EAGAIN;
+}
+
+static void RingClose(IO_QUEUE* q)
+{
+	munmap(q->sqes, q->sqes_size);
+	if (q->cq_ptr != q->sq_ptr) munmap(q->cq_ptr, q->cq_size);
+	munmap(q->sq_ptr, q->sq_size);
+	close(q->ring);
+	q->ring = -1;
+}
+
+// io_uringgȂȂēŏ̂ɐ؂ւAIĂȂv͎c𓯊ŏ
+// iʒuɓf[^ǂݏȂ̂ŁAJ[l̒œr܂ŐiłĂʂ͕ςȂj
+static void RingFail(IO_QUEUE* q)
+{
+	RingClose(q);
+	std::vector<uint8_t> idle(q->requests.size());
+	for (size_t slot : q->free) idle[slot] = 1;
+	for (size_t slot = 0; slot < q->requests.size(); slot++)
+		if (!idle[slot]) q->pending.push_back(slot);
+}
+#endif
+
+IO_QUEUE* IoQueueCreate(unsigned depth)
+{
+	IO_QUEUE* q = new IO_QUEUE;
+	depth = std::max(depth, 1u);
+#ifdef IO_URING_SUPPORTED
+	if (!RingInit(q, depth)) q->ring = -1;
+#endif
+	q->requests.resize(depth);
+	for (size_t i = depth; i-- > 0;) q->free.push_back(i);
+	return q;
+}
+
+void IoQueueDestroy(IO_QUEUE* q)
+{
+	if (!q) return;
+#ifdef IO_URING_SUPPORTED
+	if (q->ring >= 0) RingClose(q);
+#endif
+	delete q;
+}
+
+bool IoQueueIsAsync(const IO_QUEUE* q)
+{
+#ifdef IO_URING_SUPPORTED
+	return q->ring >= 0;
+#else
+	(void)q;
+	return false;
+#endif
+}
+
+size_t IoQueueFree(const IO_QUEUE* q)
+{
+	return q->free.size();
+}
+
+static bool QueuePush(IO_QUEUE* q, IO_FILE* file, uint8_t* data, size_t len, uint64_t offset, uint64_t tag, bool write)
+{
+	if (q->free.empty()) return false;
+	const size_t slot = q->free.back();
+	q->free.pop_back();
+	IO_REQUEST& r = q->requests[slot];
+	r.file = file; r.data = data; r.len = len; r.done = 0;
+	r.offset = offset; r.tag = tag; r.write = write;
+#ifdef IO_URING_SUPPORTED
+	if (q->ring >= 0)
+	{
+		RingPush(q, slot);
+		return true;
+	}
+#endif
+	// ŏƂAǂݍ݂͐ɃJ[lɐǂ݂Ă
+	if (!write) IoAdvise(file, offset, len, IO_ADVICE_WILLNEED);
+	q->pending.push_back(slot);
+	return true;
+}
+
+bool IoQueueRead(IO_QUEUE* q, IO_FILE* file, void* data, size_t len, uint64_t offset, uint64_t tag)
+{
+	return QueuePush(q, file, (uint8_t*)data, len, offset, tag, false);
+}
+
+bool IoQueueWrite(IO_QUEUE* q, IO_FILE* file, const void* data, size_t len, uint64_t offset, uint64_t tag)
+{
+	return QueuePush(q, file, (uint8_t*)data, len, offset, tag, true);
+}
+
+void IoQueueSubmit(IO_QUEUE* q)
+{
+#ifdef IO_URING_SUPPORTED
+	if (q->ring >= 0 && q->unsubmitted && !RingRetry(RingEnter(q, 0))) RingFail(q);
+#else
+	(void)q;
+#endif
+}
+
+bool IoQueueWait(IO_QUEUE* q, uint64_t* tag, bool* result)
+{
+	if (q->free.size() == q->requests.size()) return false;
+#ifdef IO_URING_SUPPORTED
+	while (q->ring >= 0)
+	{
+		const unsigned head = *q->cq_head;
+		if (head == __atomic_load_n(q->cq_tail, __ATOMIC_ACQUIRE))
+		{
+			if (!RingRetry(RingEnter(q, 1))) RingFail(q);
+			continue;
+		}
+		const io_uring_cqe cqe = q->cqes[head & q->cq_mask];
+		__atomic_store_n(q->cq_head, head + 1, __ATOMIC_RELEASE);
+
+		// r܂łǂݏłȂƂ⊄荞܂ꂽƂ́Acςݒ
+		const size_t slot = (size_t)cqe.user_data;
+		IO_REQUEST& r = q->requests[slot];
+		if (cqe.res == -EINTR || cqe.res == -EAGAIN || (cqe.res > 0 && r.done + cqe.res < r.len))
+		{
+			if (cqe.res > 0) r.done += cqe.res;
+			RingPush(q, slot);
+			continue;
+		}
+		*tag = r.tag;
+		*result = cqe.res >= 0 && r.done + cqe.res == r.len;
+		q->free.push_back(slot);
+		return true;
+	}
+#endif
+	const size_t slot = q->pending.front();
+	q->pending.pop_front();
+	IO_REQUEST& r = q->requests[slot];
+	*tag = r.tag;
+	*result = r.write ? IoWrite(r.file, r.data + r.done, r.len - r.done, r.offset + r.done) : IoRead(r.file, r.data + r.done, r.len - r.done, r.offset + r.done);
+	q->free.push_back(slot);
+	return true;
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// O_DIRECTœǂݏƂɃobt@EʒuE𑵂P
+constexpr size_t IO_ALIGN = 4096;
+constexpr size_t IO_BUFFER_SIZE = 1024 * 1024;
+
+enum IO_ADVICE : uint8_t {
+	IO_ADVICE_SEQUENTIAL,	// 擪珇ɓǂށiǂ݂𑝂₷j
+	IO_ADVICE_WILLNEED,	// ɓǂނ̂Őɓǂݍł
+	IO_ADVICE_DONTNEED,	// ǂ܂Ȃ̂Ńy[WLbVǂoĂ悢
+};
+
+// t@C̓ǂݏ͈ʒuw肵čsALV[NʒuȂ̂ŕ̃Xbh瓯ɎgB
+// POSIXłpread/pwrite/posix_fadviseAWindowsłOVERLAPPEDňʒuw肵ReadFile/WriteFilegB
+struct IO_FILE;
+
+// writeȂt@C蒼BdirectȂy[WLbVʂȂiO_DIRECTAWindowsł
+// FILE_FLAG_NO_BUFFERINGjBt@CVXeΉĂȂΒʏ̃[hŊJB
+IO_FILE* IoOpen(const std::filesystem::path& path, bool write, bool direct = false);
+void IoClose(IO_FILE* file);
+bool IoIsDirect(const IO_FILE* file);
+uint64_t IoSize(const IO_FILE* file);
+// lenoCgׂĂǂݏłƂtrueԂ
+bool IoRead(IO_FILE* file, void* data, size_t len, uint64_t offset);
+bool IoWrite(IO_FILE* file, const void* data, size_t len, uint64_t offset);
+bool IoTruncate(IO_FILE* file, uint64_t size);
+// sizeoCg̗̈ɊmۂiLinuxłfallocatejB傫͕ςȂBΉĂȂfalseԂ
+bool IoAllocate(IO_FILE* file, uint64_t size);
+// ܂ȂɂiWindowsłFSCTL_SET_SPARSEKvjB̂IoTruncateő傫߂
+bool IoSetSparse(IO_FILE* file);
+// inin_offsetlenoCgoutout_offsetփRs[BLinuxłcopy_file_rangeŃJ[l̒
+// Rs[iΉt@CVXełreflinkɂȂjAgȂ΃obt@ēǂݏ
+bool IoCopy(IO_FILE* in, uint64_t in_offset, IO_FILE* out, uint64_t out_offset, uint64_t len);
+// ΉĂȂł͉ȂBlen0Ȃoffsett@C̍Ō܂
+void IoAdvise(IO_FILE* file, uint64_t offset, uint64_t len, IO_ADVICE advice);
+
+// IO_ALIGNɑobt@mہE
+void* IoAlloc(size_t size);
+void IoFree(void* data);
+
+// 擪珇ɏǂށiwb_ȂǁjƂɁAbuffeȓ傫܂Ƃ߂ēǂݍ
+struct IO_READER {
+	IO_FILE* file;
+	uint64_t offset;	// buffer̐擪̃t@C̈ʒu
+	uint8_t* buffer;
+	size_t size, pos, len;
+};
+
+void IoReaderInit(IO_READER* r, IO_FILE* file, uint64_t offset, size_t size = IO_BUFFER_SIZE);
+bool IoReaderRead(IO_READER* r, void* data, size_t len);
+uint64_t IoReaderTell(const IO_READER* r);
+void IoReaderFree(IO_READER* r);
+
+// 擪珇ɏoƂɁAbuffeȓ傫܂Ƃ߂ďށBsizeIO_ALIGN̔{ɐ؂グB
+// directŊJt@Cł͍Ō̔[ȕIO_ALIGN܂Ŗ߂ďAIoWriterFinishŖ߂؂l߂B
+// offsetĂȂΑʒu珑n߁Aoffset܂ł0Ŗ߂̂ŁA͂̕ƂŏƁB
+// directłȂt@Cł́Abufferɓ肫Ȃ݂̓Rs[ɂ̂܂܏B
+struct IO_WRITER {
+	IO_FILE* file;
+	uint64_t offset;
+	uint8_t* buffer;
+	size_t size, len;
+	bool failed;
+};
+
+void IoWriterInit(IO_WRITER* w, IO_FILE* file, uint64_t offset = 0, size_t size = IO_BUFFER_SIZE);
+bool IoWriterWrite(IO_WRITER* w, const void* data, size_t len);
+// coăobt@Brŏ݂ɎsĂfalseԂ
+bool IoWriterFinish(IO_WRITER* w);
+
+
+// ̓ǂݏ܂Ƃ߂ĔsAÎ珇Ɏ󂯎BLinuxłio_uringgA
+// gȂIoQueueWait̒1pread/pwriteirio_uringG[ԂƂAIĂȂv؂ւjB
+// 1̃XbhgƁB
+struct IO_QUEUE;
+
+// depth͓ɔsłv̐
+IO_QUEUE* IoQueueCreate(unsigned depth = 64);
+void IoQueueDestroy(IO_QUEUE* q);
+bool IoQueueIsAsync(const IO_QUEUE* q);
+// Ƃvς߂邩
+size_t IoQueueFree(const IO_QUEUE* q);
+// vςށB󂫂ȂfalseԂ̂ŁAIoQueueWaitŊ󂯎ĂςݒB
+// data͊󂯎܂ŎgBtag͊Ƃɂ̂܂ܕԂ
+bool IoQueueRead(IO_QUEUE* q, IO_FILE* file, void* data, size_t len, uint64_t offset, uint64_t tag);
+bool IoQueueWrite(IO_QUEUE* q, IO_FILE* file, const void* data, size_t len, uint64_t offset, uint64_t tag);
+// ς񂾗vJ[lɓniIoQueueWaitnĂ҂j
+void IoQueueSubmit(IO_QUEUE* q);
+// v1󂯎BresultlenoCgׂĂǂݏłBs̗vȂfalseԂ
+bool IoQueueWait(IO_QUEUE* q, uint64_t* tag, bool* result);
@@ -1,21 +1,106 @@
 #include "archive.h"
+#include "bench.h"
+#include "crypto.h"
+#include <chrono>
+
+// i݋1b10܂1sɏ㏑ĕ\it@CƂɉsătbVƁAt@CƂɒxȂj
+// ꂽGg͂̓sx\
+static void PrintProgress(const ARCHIVE_EVENT& event, void*)
+{
+	static std::chrono::steady_clock::time_point start, last;
+	const auto now = std::chrono::steady_clock::now();
+	if (event.type == ARCHIVE_EVENT_ENTRY_BEGIN) return;
+	if (event.type == ARCHIVE_EVENT_BEGIN) start = now;
+	if (event.type == ARCHIVE_EVENT_ENTRY_END)
+	{
+		if (!event.ok) std::cout << "\rcorrupted: " << event.path << "\n";
+		if (now - last < std::chrono::milliseconds(100)) return;
+	}
+	last = now;
+
+	const double mb = event.bytes_done / (1024.0 * 1024.0);
+	std::cout << "\r" << event.files_done << "/" << event.files_total << " files, " << mb << "/" << event.bytes_total / (1024.0 * 1024.0) << " MB";
+	if (event.type != ARCHIVE_EVENT_END)
+	{
+		std::cout << std::flush;
+		return;
+	}
+
+	const double seconds = std::chrono::duration<double>(now - start).count();
+	std::cout << ", compression ratio: " << (event.bytes_done ? (float)event.pressed_done / (float)event.bytes_done * 100.0f : 0.0f) << " %";
+	std::cout << ", " << seconds << " s (" << (seconds > 0 ? mb / seconds : 0.0) << " MB/s)" << std::endl;
+}
 
 int Encode(int argc, char** argv)
 {
 	if (argc == 1)
 	{
 		std::cout << std::endl;
-		std::cout << " Usage: " << argv[0] << " forder(or file) [password] [compress level (0-9)] [is encrypt (1/0)]" << std::endl;
+		std::cout << " Usage: " << argv[0] << " forder(or file) [password] [compress level (0-9/auto[:MB/s]/decode)] [is encrypt (1/0)] [cipher (cbc/ctr/gcm)] [checksum (crc32c/sha3/none)]" << std::endl;
 		std::cout << std::endl;
 		std::cout << " Ex1: " << argv[0] << " folder word 9 1 (password: word, compress level: max, is encrypt: true)" << std::endl;
 		std::cout << " Ex2: " << argv[0] << " file sample 0 0 (password: sample, compress level: uncompressed, is encrypt: false)" << std::endl;
+		std::cout << " Ex3: " << argv[0] << " folder word 6 1 ctr (password: word, compress level: default, cipher: AES-CTR)" << std::endl;
+		std::cout << " Ex4: " << argv[0] << " folder word 6 1 gcm (password: word, compress level: default, cipher: AES-GCM)" << std::endl;
+		std::cout << " Ex5: " << argv[0] << " folder word 6 1 cbc sha3 (password: word, compress level: default, checksum: SHA3-256)" << std::endl;
+		std::cout << " Ex6: " << argv[0] << " folder word auto:100 1 (password: word, compress level: best ratio packing at least 100 MB/s per thread)" << std::endl;
+		std::cout << " Ex7: " << argv[0] << " folder word decode 1 (password: word, compress level: fastest to decode)" << std::endl;
 		return -1;
 	}
 	if (argc > 2) SetArchivePassword(argv[2]);
+	if (argc > 5)
+	{
+		const std::string mode = argv[5];
+		SetArchiveCipher(mode == "ctr" ? ARCHIVE_CIPHER_CTR : mode == "gcm" ? ARCHIVE_CIPHER_GCM : ARCHIVE_CIPHER_CBC);
+	}
+	if (argc > 6)
+	{
+		const std::string sum = argv[6];
+		SetArchiveChecksum(sum == "sha3" ? ARCHIVE_CHECKSUM_SHA3 : sum == "none" ? ARCHIVE_CHECKSUM_NONE : ARCHIVE_CHECKSUM_CRC32C);
+	}
+
+	// x̑autodecodew肷ƁAgqƂɎĐݒIԁĩxȂ玎Ȃj
+	int level = Z_DEFAULT_COMPRESSION;
+	std::vector<ARCHIVE_LEVEL_CHOICE> choices;
+	if (argc > 3)
+	{
+		const std::string arg = argv[3];
+		char* end = nullptr;
+		if (arg == "auto" || arg.compare(0, 5, "auto:") == 0)
+		{
+			const double speed = arg.size() > 4 ? strtod(arg.c_str() + 5, &end) : 50;
+			if (arg.size() > 4 && (*end || speed <= 0))
+			{
+				std::cout << " Invalid speed: " << arg << std::endl;
+				return -1;
+			}
+			SetArchiveLevelGoal(ARCHIVE_LEVEL_RATIO, speed);
+			SetArchiveLevelChoices(&choices);
+		}
+		else if (arg == "decode")
+		{
+			SetArchiveLevelGoal(ARCHIVE_LEVEL_DECODE);
+			SetArchiveLevelChoices(&choices);
+		}
+		else
+		{
+			const long n = strtol(arg.c_str(), &end, 10);
+			if (arg.empty() || *end || n < 0 || n > 9)
+			{
+				std::cout << " Invalid compress level: " << arg << std::endl;
+				return -1;
+			}
+			level = (int)n;
+		}
+	}
 
-	if (argc > 4) EncodeArchive(argv[1], argv[3][0] - '0', argv[4][0] - '0');
-	else if (argc > 3) EncodeArchive(argv[1], argv[3][0] - '0');
-	else EncodeArchive(argv[1]);
+	ARCHIVE_STATS stats;
+	SetArchiveStats(&stats);
+	SetArchiveCallback(PrintProgress);
+	if (argc > 4) EncodeArchive(argv[1], level, argv[4][0] - '0');
+	else EncodeArchive(argv[1], level);
+	PrintArchiveStats(stats);
+	if (!choices.empty()) PrintArchiveLevelChoices(choices);
 
 	system("pause");
 	return 0;
@@ -26,19 +111,54 @@ int Decode(int argc, char** argv)
 	if (argc == 1) 
 	{
 		std::cout << std::endl;
-		std::cout << " Usage: " << argv[0] << " forder(or file) [password]" << std::endl;
+		std::cout << " Usage: " << argv[0] << " forder(or file) [password] [pattern]" << std::endl;
 		std::cout << std::endl;
-		std::cout << " Ex: " << argv[0] << " folder test (password: test)" << std::endl;
+		std::cout << " Ex1: " << argv[0] << " folder test (password: test)" << std::endl;
+		std::cout << " Ex2: " << argv[0] << " folder test maps\\level3\\** (password: test, extract: files under maps\\level3)" << std::endl;
 		return -1;
 	}
 	if (argc > 2) SetArchivePassword(argv[2]);
-	if (!DecodeArchive(argv[1])) std::cout << "Invalid password" << std::endl;
+	ARCHIVE_STATS stats;
+	SetArchiveStats(&stats);
+	SetArchiveCallback(PrintProgress);
+	if (!(argc > 3 ? DecodeArchive(argv[1], argv[3]) : DecodeArchive(argv[1]))) std::cout << "Invalid password" << std::endl;
+	else PrintArchiveStats(stats);
 	system("pause");
 	return 0;
 }
 
+int Verify(int argc, char** argv)
+{
+	if (argc == 1)
+	{
+		std::cout << std::endl;
+		std::cout << " Usage: " << argv[0] << " archive [password]" << std::endl;
+		std::cout << std::endl;
+		std::cout << " Ex: " << argv[0] << " folder.dat test (password: test)" << std::endl;
+		return -1;
+	}
+	if (argc > 2) SetArchivePassword(argv[2]);
+	SetArchiveCallback(PrintProgress);
+	const bool ok = VerifyArchive(argv[1]);
+	std::cout << (ok ? "OK" : "NG") << std::endl;
+	system("pause");
+	return ok ? 0 : 1;
+}
+
+// AES̕\ɂƖ߂ɂFIPS-197GCM̊m̒lɍm߂
+int SelfTest(int, char**)
+{
+	const bool ok = AesSelfTest();
+	std::cout << "AES self test: " << (ok ? "OK" : "NG") << std::endl;
+	system("pause");
+	return ok ? 0 : 1;
+}
+
 int main(int argc, char** argv)
 {
 	return Encode(argc, argv);
 	return Decode(argc, argv);
+	return Verify(argc, argv);
+	return Bench(argc, argv);
+	return SelfTest(argc, argv);
 }
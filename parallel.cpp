@@ -0,0 +1,58 @@
+#include "parallel.h"
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+// ParallelFor̃[J[Bjobs̐擪`Ăяo
+struct WORKER_POOL {
+	std::mutex lock;
+	std::condition_variable wake;	// jobsɒǉ
+	std::condition_variable done;	// jobactive0ɂȂ
+	std::vector<PARALLEL_JOB*> jobs;
+	std::vector<std::thread> threads;
+};
+
+// [J[͑҂ĂԂIɎ~߂Ȃ̂ŁAv[͉Ȃ
+static WORKER_POOL& pool = *new WORKER_POOL;
+
+static void RunJob(PARALLEL_JOB& job)
+{
+	for (size_t i = job.next++; i < job.count; i = job.next++) job.run(job.func, i);
+}
+
+static void WorkerMain()
+{
+	std::unique_lock<std::mutex> lock(pool.lock);
+	for (;;)
+	{
+		pool.wake.wait(lock, [] { return !pool.jobs.empty(); });
+		PARALLEL_JOB& job = *pool.jobs.front();
+		if (--job.helpers == 0) pool.jobs.erase(pool.jobs.begin());
+		job.active++;
+		lock.unlock();
+		RunJob(job);
+		lock.lock();
+		if (--job.active == 0) pool.done.notify_all();
+	}
+}
+
+void RunParallelJob(PARALLEL_JOB& job, unsigned threads)
+{
+	{
+		std::lock_guard<std::mutex> lock(pool.lock);
+		while (pool.threads.size() < threads - 1) pool.threads.emplace_back(WorkerMain);
+		job.helpers = threads - 1;
+		job.active = 0;
+		pool.jobs.push_back(&job);
+	}
+	pool.wake.notify_all();
+
+	// ĂяoXbh`̂ŁA[J[ق̌ĂяoŖ܂ĂĂiށiq̌Ăяoł~܂Ȃj
+	RunJob(job);
+
+	std::unique_lock<std::mutex> lock(pool.lock);
+	const auto it = std::find(pool.jobs.begin(), pool.jobs.end(), &job);
+	if (it != pool.jobs.end()) pool.jobs.erase(it);
+	pool.done.wait(lock, [&] { return job.active == 0; });
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <atomic>
+#include <thread>
+
+inline unsigned GetThreadCount()
+{
+	unsigned n = std::thread::hardware_concurrency();
+	return n ? n : 1;
+}
+
+// ParallelFor1̌ĂяoBĂяoXbhƃ[J[nextCfbNX荇
+struct PARALLEL_JOB {
+	void (*run)(void* func, size_t i);
+	void* func;
+	size_t count;
+	std::atomic<size_t> next;
+	unsigned helpers;	// ꂩ`郏[J[̐
+	unsigned active;	// ܎`Ă郏[J[̐
+};
+
+// jobĂяoXbhthreads-1܂ł̃[J[ŎsAׂẴCfbNXI܂ő҂B
+// [J[͍ŏɕKvɂȂƂɍAvZXI܂Ŏg
+void RunParallelJob(PARALLEL_JOB& job, unsigned threads);
+
+// 0count-1܂ł̃CfbNXfuncɌĂяoithreads0ȂRÃXbhgjB
+// func̒ParallelForĂł悢
+template <class Func>
+void ParallelFor(size_t count, Func func, unsigned threads = 0)
+{
+	if (threads == 0) threads = GetThreadCount();
+	if (threads > count) threads = (unsigned)count;
+	if (threads <= 1) {
+		for (size_t i = 0; i < count; i++) func(i);
+		return;
+	}
+
+	PARALLEL_JOB job;
+	job.run = [](void* f, size_t i) { (*(Func*)f)(i); };
+	job.func = &func;
+	job.count = count;
+	job.next = 0;
+	RunParallelJob(job, threads);
+}
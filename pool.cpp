@@ -0,0 +1,192 @@
+#include "pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+// 64KB1GB܂ł2̗ݏ1̃NXƂANXƂɎĂƑŜ̑傫ɏ݂
+constexpr size_t POOL_MIN_SIZE = 64 * 1024;
+constexpr int POOL_CLASSES = 15;
+constexpr size_t POOL_CLASS_BUFFERS = 8;
+constexpr size_t POOL_THREAD_BUFFERS = 2;
+constexpr size_t POOL_CACHE_SIZE = 256 * 1024 * 1024;
+
+// SXbhŋLu
+struct POOL_CLASS {
+	std::mutex lock;
+	std::vector<void*> buffers;
+};
+
+// XbhƂ̎uB܂؂ĕԂA󂩈t̂ƂPOOL_CLASSgB
+// PoolTrimق̃XbhɂƂ̂߂ŁAӂ͎̃XbhȂ
+struct POOL_CACHE {
+	std::mutex lock;
+	std::vector<void*> buffers[POOL_CLASSES];
+	POOL_CACHE();
+	~POOL_CACHE();
+};
+
+static void* DefaultAlloc(size_t size, void*)
+{
+	return malloc(size);
+}
+
+static void DefaultFree(void* data, size_t, void*)
+{
+	free(data);
+}
+
+struct POOL {
+	POOL_CLASS classes[POOL_CLASSES];
+	std::mutex caches_lock;
+	std::vector<POOL_CACHE*> caches;
+	std::atomic<size_t> cached{ 0 };
+	POOL_ALLOC alloc = DefaultAlloc;
+	POOL_FREE free = DefaultFree;
+	void* user = nullptr;
+	~POOL() { PoolTrim(); }
+};
+
+static POOL pool;
+
+static int GetClass(size_t size)
+{
+	for (int k = 0; k < POOL_CLASSES; k++)
+		if (size <= POOL_MIN_SIZE << k) return k;
+	return -1;
+}
+
+// u𑝂₵Ă悯cachedɉ
+static bool ReserveCache(size_t bytes)
+{
+	size_t now = pool.cached;
+	do {
+		if (now + bytes > POOL_CACHE_SIZE) return false;
+	} while (!pool.cached.compare_exchange_weak(now, now + bytes));
+	return true;
+}
+
+// NXk̃obt@L̎uɕԂ
+static void FreeShared(void* data, int k)
+{
+	const size_t bytes = POOL_MIN_SIZE << k;
+	POOL_CLASS& c = pool.classes[k];
+	{
+		std::lock_guard<std::mutex> guard(c.lock);
+		if (c.buffers.size() < POOL_CLASS_BUFFERS && ReserveCache(bytes))
+		{
+			c.buffers.push_back(data);
+			return;
+		}
+	}
+	pool.free(data, bytes, pool.user);
+}
+
+POOL_CACHE::POOL_CACHE()
+{
+	std::lock_guard<std::mutex> guard(pool.caches_lock);
+	pool.caches.push_back(this);
+}
+
+// XbhIƂ͎uL̕ֈڂi肫Ȃ͉j
+POOL_CACHE::~POOL_CACHE()
+{
+	{
+		std::lock_guard<std::mutex> guard(pool.caches_lock);
+		pool.caches.erase(std::find(pool.caches.begin(), pool.caches.end(), this));
+	}
+	for (int k = 0; k < POOL_CLASSES; k++)
+	{
+		for (void* data : buffers[k])
+		{
+			pool.cached -= POOL_MIN_SIZE << k;
+			FreeShared(data, k);
+		}
+	}
+}
+
+static thread_local POOL_CACHE cache;
+
+void SetPoolAllocator(POOL_ALLOC alloc, POOL_FREE free, void* user)
+{
+	PoolTrim();
+	pool.alloc = alloc ? alloc : DefaultAlloc;
+	pool.free = alloc ? free : DefaultFree;
+	pool.user = alloc ? user : nullptr;
+}
+
+void* PoolAlloc(size_t size)
+{
+	const int k = GetClass(size);
+	if (k < 0) return pool.alloc(size, pool.user);
+
+	{
+		std::lock_guard<std::mutex> guard(cache.lock);
+		if (!cache.buffers[k].empty())
+		{
+			void* data = cache.buffers[k].back();
+			cache.buffers[k].pop_back();
+			pool.cached -= POOL_MIN_SIZE << k;
+			return data;
+		}
+	}
+	POOL_CLASS& c = pool.classes[k];
+	{
+		std::lock_guard<std::mutex> guard(c.lock);
+		if (!c.buffers.empty())
+		{
+			void* data = c.buffers.back();
+			c.buffers.pop_back();
+			pool.cached -= POOL_MIN_SIZE << k;
+			return data;
+		}
+	}
+	return pool.alloc(POOL_MIN_SIZE << k, pool.user);
+}
+
+void PoolFree(void* data, size_t size)
+{
+	if (!data) return;
+	const int k = GetClass(size);
+	if (k < 0)
+	{
+		pool.free(data, size, pool.user);
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> guard(cache.lock);
+		if (cache.buffers[k].size() < POOL_THREAD_BUFFERS && ReserveCache(POOL_MIN_SIZE << k))
+		{
+			cache.buffers[k].push_back(data);
+			return;
+		}
+	}
+	FreeShared(data, k);
+}
+
+void PoolTrim()
+{
+	{
+		std::lock_guard<std::mutex> guard(pool.caches_lock);
+		for (POOL_CACHE* t : pool.caches)
+		{
+			std::lock_guard<std::mutex> cache_guard(t->lock);
+			for (int k = 0; k < POOL_CLASSES; k++)
+			{
+				for (void* data : t->buffers[k]) pool.free(data, POOL_MIN_SIZE << k, pool.user);
+				pool.cached -= (POOL_MIN_SIZE << k) * t->buffers[k].size();
+				t->buffers[k].clear();
+			}
+		}
+	}
+	for (int k = 0; k < POOL_CLASSES; k++)
+	{
+		POOL_CLASS& c = pool.classes[k];
+		std::lock_guard<std::mutex> guard(c.lock);
+		for (void* data : c.buffers) pool.free(data, POOL_MIN_SIZE << k, pool.user);
+		pool.cached -= (POOL_MIN_SIZE << k) * c.buffers.size();
+		c.buffers.clear();
+	}
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// GgƂ̍Ɨpobt@̃v[B傫2̗ݏ̃NXɐ؂グAԂꂽobt@
+// XbhƁENXƂɎĂĎg񂷁imۂƃy[WtH[g炷jBǂ̃XbhgĂ悢B
+// 傫obt@̓v[ɓꂸɂ̂܂܊mہEB
+
+// mۂƉ̊֐BuserSetPoolAllocatorɓn̂̂܂ܓn
+typedef void* (*POOL_ALLOC)(size_t size, void* user);
+typedef void (*POOL_FREE)(void* data, size_t size, void* user);
+
+// mۂƉ̊֐ւiQ[GWȂǂ̃AP[^gƂjBnullptrȂmalloc/freeɖ߂B
+// Ăobt@͑O̊֐ŉBv[؂Ăobt@ȂƂɌĂԂƁB
+void SetPoolAllocator(POOL_ALLOC alloc, POOL_FREE free, void* user = nullptr);
+// sizeoCgȏ̃obt@؂BԂƂPoolFreeɓsizen
+void* PoolAlloc(size_t size);
+void PoolFree(void* data, size_t size);
+// Ăobt@ׂĉ
+void PoolTrim();
+
+// PoolAllocŎ؂肽obt@BXR[v𔲂邩ʂ̃obt@ƃv[ɕԂ
+struct POOL_BUFFER {
+	uint8_t* data;
+	size_t size;
+
+	POOL_BUFFER() : data(nullptr), size(0) {}
+	explicit POOL_BUFFER(size_t _size) : data((uint8_t*)PoolAlloc(_size)), size(_size) {}
+	POOL_BUFFER(POOL_BUFFER&& b) noexcept : data(b.data), size(b.size) { b.data = nullptr; b.size = 0; }
+	POOL_BUFFER& operator=(POOL_BUFFER&& b) noexcept { std::swap(data, b.data); std::swap(size, b.size); return *this; }
+	POOL_BUFFER(const POOL_BUFFER&) = delete;
+	POOL_BUFFER& operator=(const POOL_BUFFER&) = delete;
+	~POOL_BUFFER() { if (data) PoolFree(data, size); }
+};
@@ -45,36 +45,92 @@ static inline uint64_t RotateLeft(uint64_t ui64Value, unsigned int uiShift)
 }
 
 //SHA3XV
+#if defined(_WIN64) || UINTPTR_MAX == 0xffffffffffffffffULL
+//64bitł̓EhWJA[ϐɒuČvZ
+//ԂNOT炷߁A1, 2, 8, 12, 17, 20Ԗڂ̃[𔽓]ԂŌvZilane complementingj
+#define KECCAK_ROUND(A, E, rnd) \
+	Ca = A##ba ^ A##ga ^ A##ka ^ A##ma ^ A##sa; \
+	Ce = A##be ^ A##ge ^ A##ke ^ A##me ^ A##se; \
+	Ci = A##bi ^ A##gi ^ A##ki ^ A##mi ^ A##si; \
+	Co = A##bo ^ A##go ^ A##ko ^ A##mo ^ A##so; \
+	Cu = A##bu ^ A##gu ^ A##ku ^ A##mu ^ A##su; \
+	Da = Cu ^ RotateLeft(Ce, 1); De = Ca ^ RotateLeft(Ci, 1); Di = Ce ^ RotateLeft(Co, 1); \
+	Do = Ci ^ RotateLeft(Cu, 1); Du = Co ^ RotateLeft(Ca, 1); \
+	\
+	Ba = A##ba ^ Da; Be = RotateLeft(A##ge ^ De, 44); Bi = RotateLeft(A##ki ^ Di, 43); \
+	Bo = RotateLeft(A##mo ^ Do, 21); Bu = RotateLeft(A##su ^ Du, 14); \
+	E##ba = Ba ^ (Be | Bi) ^ c_anRoundConstant[rnd]; E##be = Be ^ (~Bi | Bo); \
+	E##bi = Bi ^ (Bo & Bu); E##bo = Bo ^ (Bu | Ba); E##bu = Bu ^ (Ba & Be); \
+	\
+	Ba = RotateLeft(A##bo ^ Do, 28); Be = RotateLeft(A##gu ^ Du, 20); Bi = RotateLeft(A##ka ^ Da, 3); \
+	Bo = RotateLeft(A##me ^ De, 45); Bu = RotateLeft(A##si ^ Di, 61); \
+	E##ga = Ba ^ (Be | Bi); E##ge = Be ^ (Bi & Bo); \
+	E##gi = Bi ^ (Bo | ~Bu); E##go = Bo ^ (Bu | Ba); E##gu = Bu ^ (Ba & Be); \
+	\
+	Ba = RotateLeft(A##be ^ De, 1); Be = RotateLeft(A##gi ^ Di, 6); Bi = RotateLeft(A##ko ^ Do, 25); \
+	Bo = RotateLeft(A##mu ^ Du, 8); Bu = RotateLeft(A##sa ^ Da, 18); \
+	E##ka = Ba ^ (Be | Bi); E##ke = Be ^ (Bi & Bo); \
+	E##ki = Bi ^ (~Bo & Bu); E##ko = ~Bo ^ (Bu | Ba); E##ku = Bu ^ (Ba & Be); \
+	\
+	Ba = RotateLeft(A##bu ^ Du, 27); Be = RotateLeft(A##ga ^ Da, 36); Bi = RotateLeft(A##ke ^ De, 10); \
+	Bo = RotateLeft(A##mi ^ Di, 15); Bu = RotateLeft(A##so ^ Do, 56); \
+	E##ma = Ba ^ (Be & Bi); E##me = Be ^ (Bi | Bo); \
+	E##mi = Bi ^ (~Bo | Bu); E##mo = ~Bo ^ (Bu & Ba); E##mu = Bu ^ (Ba | Be); \
+	\
+	Ba = RotateLeft(A##bi ^ Di, 62); Be = RotateLeft(A##go ^ Do, 55); Bi = RotateLeft(A##ku ^ Du, 39); \
+	Bo = RotateLeft(A##ma ^ Da, 41); Bu = RotateLeft(A##se ^ De, 2); \
+	E##sa = Ba ^ (~Be & Bi); E##se = ~Be ^ (Bi | Bo); \
+	E##si = Bi ^ (Bo & Bu); E##so = Bo ^ (Bu | Ba); E##su = Bu ^ (Ba & Be);
+
 void SHA3Update(uint64_t state[25])
 {
-#ifdef _WIN64
-#define A(x,y)		ep1[(x) + (y) * 5]
-#define E(x,y)		ep2[(x) + (y) * 5]
+	uint64_t Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki, Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+	uint64_t Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki, Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+	uint64_t Ba, Be, Bi, Bo, Bu, Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du;
 
-	uint64_t B[5], C[5], D[5], work[25]; uint64_t* ep1, * ep2, * ep; size_t rnd; uint32_t x, y, xp, yp;
+	Aba = state[0];  Abe = ~state[1];  Abi = ~state[2];  Abo = state[3];   Abu = state[4];
+	Aga = state[5];  Age = state[6];   Agi = state[7];   Ago = ~state[8];  Agu = state[9];
+	Aka = state[10]; Ake = state[11];  Aki = ~state[12]; Ako = state[13];  Aku = state[14];
+	Ama = state[15]; Ame = state[16];  Ami = ~state[17]; Amo = state[18];  Amu = state[19];
+	Asa = ~state[20]; Ase = state[21]; Asi = state[22];  Aso = state[23];  Asu = state[24];
 
-	ep1 = &state[0]; ep2 = &work[0];
-	for (rnd = 0; rnd < SHA3_ROUND; rnd++) {
-		for (x = 0; x < 5; x++) { C[x] = A(x, 0) ^ A(x, 1) ^ A(x, 2) ^ A(x, 3) ^ A(x, 4); }
-		for (x = 0; x < 5; x++) { D[x] = C[c_anIndexM1M5[x]] ^ RotateLeft(C[c_anIndexP1M5[x]], 1); }
+	KECCAK_ROUND(A, E, 0)
+	KECCAK_ROUND(E, A, 1)
+	KECCAK_ROUND(A, E, 2)
+	KECCAK_ROUND(E, A, 3)
+	KECCAK_ROUND(A, E, 4)
+	KECCAK_ROUND(E, A, 5)
+	KECCAK_ROUND(A, E, 6)
+	KECCAK_ROUND(E, A, 7)
+	KECCAK_ROUND(A, E, 8)
+	KECCAK_ROUND(E, A, 9)
+	KECCAK_ROUND(A, E, 10)
+	KECCAK_ROUND(E, A, 11)
+	KECCAK_ROUND(A, E, 12)
+	KECCAK_ROUND(E, A, 13)
+	KECCAK_ROUND(A, E, 14)
+	KECCAK_ROUND(E, A, 15)
+	KECCAK_ROUND(A, E, 16)
+	KECCAK_ROUND(E, A, 17)
+	KECCAK_ROUND(A, E, 18)
+	KECCAK_ROUND(E, A, 19)
+	KECCAK_ROUND(A, E, 20)
+	KECCAK_ROUND(E, A, 21)
+	KECCAK_ROUND(A, E, 22)
+	KECCAK_ROUND(E, A, 23)
 
-		for (y = 0; y < 5; y++) {
-			for (x = 0; x < 5; x++) {
-				xp = c_aanIndexInvMatX[y][x]; yp = x;
-				B[x] = RotateLeft(A(xp, yp) ^ D[xp], c_aanRotateCount[yp][xp]);
-			}
-			for (x = 0; x < 5; x++) {
-				E(x, y) = B[x] ^ ((~B[c_anIndexP1M5[x]]) & B[c_anIndexP2M5[x]]);
-			}
-		}
-		E(0, 0) ^= c_anRoundConstant[rnd];
-		ep = ep1; ep1 = ep2; ep2 = ep;
-	}
-
-#undef A
-#undef E
+	state[0] = Aba;  state[1] = ~Abe;  state[2] = ~Abi;  state[3] = Abo;   state[4] = Abu;
+	state[5] = Aga;  state[6] = Age;   state[7] = Agi;   state[8] = ~Ago;  state[9] = Agu;
+	state[10] = Aka; state[11] = Ake;  state[12] = ~Aki; state[13] = Ako;  state[14] = Aku;
+	state[15] = Ama; state[16] = Ame;  state[17] = ~Ami; state[18] = Amo;  state[19] = Amu;
+	state[20] = ~Asa; state[21] = Ase; state[22] = Asi;  state[23] = Aso;  state[24] = Asu;
+}
 
+#undef KECCAK_ROUND
 #else
+//32bitł͔ėp̃[vŌvZ
+void SHA3Update(uint64_t state[25])
+{
 #define A(x,y)		state[(x) + (y) * 5]
 #define B(x,y)		work[(x) + (y) * 5]
 	uint64_t C[5]{}, D[5]{}, work[25]{}; uint64_t n, m; size_t rnd; uint32_t x, y;
@@ -117,9 +173,8 @@ void SHA3Update(uint64_t state[25])
 	}
 #undef B
 #undef A
-
-#endif
 }
+#endif
 
 //SHA3
 int SHA3Init(SHA3_CTX* context, size_t hashbitlen, size_t blockbytelen)
@@ -140,23 +195,39 @@ int SHA3Init(SHA3_CTX* context, size_t hashbitlen, size_t blockbytelen)
 	return 1;
 }
 
+//ubNԂXORčXV
+static inline void SHA3Absorb(SHA3_CTX* context, const unsigned char* data)
+{
+	uint64_t word; size_t i;
+
+	//memcpy8oCg̃[hɂȂ̂ŁAEĂȂ͂̂܂ܓǂ߂
+	for (i = 0; i < context->nBlockCount; i++) {
+		memcpy(&word, data + i * SHA3_WORD, SHA3_WORD);
+		context->aui64State[i] ^= SetLittleEndian(word);
+	}
+	SHA3Update(context->aui64State);
+}
+
 void SHA3Load(SHA3_CTX* context, const unsigned char* data, size_t len)
 {
-	unsigned char* block; size_t blen, chr, rsize, i;
+	unsigned char* block; size_t blen, chr, rsize;
 
 	if (context == NULL || data == NULL) return;
 
 	block = (unsigned char*)&(context->aui64Block[0]);
 	blen = context->nBlockLength; chr = context->nBlockCursor;
 	while (len > 0) {
+		//ubN̐擪ۂƓ镪aui64BlockoRɒڎ荞
+		if (chr == 0 && len >= blen && blen % SHA3_WORD == 0) {
+			SHA3Absorb(context, data);
+			data = data + blen; len -= blen;
+			continue;
+		}
 		rsize = (len < blen - chr) ? len : (blen - chr);
 		memcpy(block + chr, data, rsize);
 		chr += rsize; data = data + rsize; len -= rsize;
 		if (chr == blen) {
-			for (i = 0; i < context->nBlockCount; i++) {
-				context->aui64State[i] ^= SetLittleEndian(context->aui64Block[i]);
-			}
-			SHA3Update(context->aui64State);
+			SHA3Absorb(context, block);
 			chr = 0;
 		}
 	}
@@ -166,16 +237,17 @@ void SHA3Load(SHA3_CTX* context, const unsigned char* data, size_t len)
 void SHA3Final(unsigned char* digest, SHA3_CTX* context)
 {
 	size_t len, size, i; uint64_t hashbuf[25], retbuf[25]{};
-	const uint8_t cZero = 0x00; const uint8_t cOne = 0x01; uint8_t cEnd = 0x80;
+	unsigned char* block;
 
 	if (context == NULL) return;
 
-	if (context->nBlockCursor != context->nBlockLength - 1) {
-		SHA3Load(context, &cOne, sizeof(cOne));
-		while (context->nBlockCursor != context->nBlockLength - 1) SHA3Load(context, &cZero, sizeof(cZero));
-	}
-	else { cEnd ^= cOne; }
-	SHA3Load(context, &cEnd, sizeof(cEnd));
+	//pfBOi0x01, 0x00..., 0x80jubNɒڏށB1oCgcĂȂ0x81ɂȂ
+	block = (unsigned char*)&(context->aui64Block[0]);
+	memset(block + context->nBlockCursor, 0x00, context->nBlockLength - context->nBlockCursor);
+	block[context->nBlockCursor] ^= 0x01;
+	block[context->nBlockLength - 1] ^= 0x80;
+	SHA3Absorb(context, block);
+	context->nBlockCursor = 0;
 
 	memcpy(hashbuf, context->aui64State, sizeof(hashbuf)); len = context->nHashLength;
 	do {
@@ -219,3 +291,211 @@ void SHA3_512(void* _data, size_t _len, void* _hash)
 	SHA3Load(&sha3, (const unsigned char*)_data, _len);
 	SHA3Final((unsigned char*)_hash, &sha3);
 }
+
+//̃bZ[WSIMD̃[ɕׂēɌvZi}`obt@j
+//Ԃst[w * SHA3_LANES_MAX + j]ɃbZ[WjwԖڂ̃[hu
+constexpr size_t SHA3_LANES_MAX = 8;
+typedef void (*SHA3_PERMUTE_X)(uint64_t* st);
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define SHA3_SIMD_SUPPORTED
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define SHA3_AVX2_TARGET
+#define SHA3_AVX512_TARGET
+#else
+#include <cpuid.h>
+#define SHA3_AVX2_TARGET __attribute__((target("avx2")))
+#define SHA3_AVX512_TARGET __attribute__((target("avx512f")))
+#endif
+
+//[ƂɓƗȂ̂ŁAԂ͑fANDNOTŌvZ
+#define KECCAK_ROUND_X(A, E, rnd) \
+	Ca = VXOR(VXOR(VXOR(A##ba, A##ga), VXOR(A##ka, A##ma)), A##sa); \
+	Ce = VXOR(VXOR(VXOR(A##be, A##ge), VXOR(A##ke, A##me)), A##se); \
+	Ci = VXOR(VXOR(VXOR(A##bi, A##gi), VXOR(A##ki, A##mi)), A##si); \
+	Co = VXOR(VXOR(VXOR(A##bo, A##go), VXOR(A##ko, A##mo)), A##so); \
+	Cu = VXOR(VXOR(VXOR(A##bu, A##gu), VXOR(A##ku, A##mu)), A##su); \
+	Da = VXOR(Cu, VROL(Ce, 1)); De = VXOR(Ca, VROL(Ci, 1)); Di = VXOR(Ce, VROL(Co, 1)); \
+	Do = VXOR(Ci, VROL(Cu, 1)); Du = VXOR(Co, VROL(Ca, 1)); \
+	\
+	Ba = VXOR(A##ba, Da); Be = VROL(VXOR(A##ge, De), 44); Bi = VROL(VXOR(A##ki, Di), 43); \
+	Bo = VROL(VXOR(A##mo, Do), 21); Bu = VROL(VXOR(A##su, Du), 14); \
+	E##ba = VXOR(VXOR(Ba, VANDN(Be, Bi)), VRC(rnd)); E##be = VXOR(Be, VANDN(Bi, Bo)); \
+	E##bi = VXOR(Bi, VANDN(Bo, Bu)); E##bo = VXOR(Bo, VANDN(Bu, Ba)); E##bu = VXOR(Bu, VANDN(Ba, Be)); \
+	\
+	Ba = VROL(VXOR(A##bo, Do), 28); Be = VROL(VXOR(A##gu, Du), 20); Bi = VROL(VXOR(A##ka, Da), 3); \
+	Bo = VROL(VXOR(A##me, De), 45); Bu = VROL(VXOR(A##si, Di), 61); \
+	E##ga = VXOR(Ba, VANDN(Be, Bi)); E##ge = VXOR(Be, VANDN(Bi, Bo)); \
+	E##gi = VXOR(Bi, VANDN(Bo, Bu)); E##go = VXOR(Bo, VANDN(Bu, Ba)); E##gu = VXOR(Bu, VANDN(Ba, Be)); \
+	\
+	Ba = VROL(VXOR(A##be, De), 1); Be = VROL(VXOR(A##gi, Di), 6); Bi = VROL(VXOR(A##ko, Do), 25); \
+	Bo = VROL(VXOR(A##mu, Du), 8); Bu = VROL(VXOR(A##sa, Da), 18); \
+	E##ka = VXOR(Ba, VANDN(Be, Bi)); E##ke = VXOR(Be, VANDN(Bi, Bo)); \
+	E##ki = VXOR(Bi, VANDN(Bo, Bu)); E##ko = VXOR(Bo, VANDN(Bu, Ba)); E##ku = VXOR(Bu, VANDN(Ba, Be)); \
+	\
+	Ba = VROL(VXOR(A##bu, Du), 27); Be = VROL(VXOR(A##ga, Da), 36); Bi = VROL(VXOR(A##ke, De), 10); \
+	Bo = VROL(VXOR(A##mi, Di), 15); Bu = VROL(VXOR(A##so, Do), 56); \
+	E##ma = VXOR(Ba, VANDN(Be, Bi)); E##me = VXOR(Be, VANDN(Bi, Bo)); \
+	E##mi = VXOR(Bi, VANDN(Bo, Bu)); E##mo = VXOR(Bo, VANDN(Bu, Ba)); E##mu = VXOR(Bu, VANDN(Ba, Be)); \
+	\
+	Ba = VROL(VXOR(A##bi, Di), 62); Be = VROL(VXOR(A##go, Do), 55); Bi = VROL(VXOR(A##ku, Du), 39); \
+	Bo = VROL(VXOR(A##ma, Da), 41); Bu = VROL(VXOR(A##se, De), 2); \
+	E##sa = VXOR(Ba, VANDN(Be, Bi)); E##se = VXOR(Be, VANDN(Bi, Bo)); \
+	E##si = VXOR(Bi, VANDN(Bo, Bu)); E##so = VXOR(Bo, VANDN(Bu, Ba)); E##su = VXOR(Bu, VANDN(Ba, Be));
+
+#define KECCAK_PERMUTE_X(V, VLOAD, VSTORE) \
+	V Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki, Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu; \
+	V Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki, Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu; \
+	V Ba, Be, Bi, Bo, Bu, Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du; \
+	size_t rnd; \
+	\
+	Aba = VLOAD(0);  Abe = VLOAD(1);  Abi = VLOAD(2);  Abo = VLOAD(3);  Abu = VLOAD(4); \
+	Aga = VLOAD(5);  Age = VLOAD(6);  Agi = VLOAD(7);  Ago = VLOAD(8);  Agu = VLOAD(9); \
+	Aka = VLOAD(10); Ake = VLOAD(11); Aki = VLOAD(12); Ako = VLOAD(13); Aku = VLOAD(14); \
+	Ama = VLOAD(15); Ame = VLOAD(16); Ami = VLOAD(17); Amo = VLOAD(18); Amu = VLOAD(19); \
+	Asa = VLOAD(20); Ase = VLOAD(21); Asi = VLOAD(22); Aso = VLOAD(23); Asu = VLOAD(24); \
+	\
+	for (rnd = 0; rnd < SHA3_ROUND; rnd += 2) { \
+		KECCAK_ROUND_X(A, E, rnd) \
+		KECCAK_ROUND_X(E, A, rnd + 1) \
+	} \
+	\
+	VSTORE(0, Aba);  VSTORE(1, Abe);  VSTORE(2, Abi);  VSTORE(3, Abo);  VSTORE(4, Abu); \
+	VSTORE(5, Aga);  VSTORE(6, Age);  VSTORE(7, Agi);  VSTORE(8, Ago);  VSTORE(9, Agu); \
+	VSTORE(10, Aka); VSTORE(11, Ake); VSTORE(12, Aki); VSTORE(13, Ako); VSTORE(14, Aku); \
+	VSTORE(15, Ama); VSTORE(16, Ame); VSTORE(17, Ami); VSTORE(18, Amo); VSTORE(19, Amu); \
+	VSTORE(20, Asa); VSTORE(21, Ase); VSTORE(22, Asi); VSTORE(23, Aso); VSTORE(24, Asu);
+
+//AVX2F4{
+#define VXOR(a, b)		_mm256_xor_si256(a, b)
+#define VANDN(a, b)		_mm256_andnot_si256(a, b)
+#define VROL(a, n)		_mm256_or_si256(_mm256_slli_epi64(a, n), _mm256_srli_epi64(a, 64 - (n)))
+#define VRC(rnd)		_mm256_set1_epi64x((long long)c_anRoundConstant[rnd])
+#define VLOAD(w)		_mm256_loadu_si256((const __m256i*)(st + (w) * SHA3_LANES_MAX))
+#define VSTORE(w, v)	_mm256_storeu_si256((__m256i*)(st + (w) * SHA3_LANES_MAX), v)
+SHA3_AVX2_TARGET static void SHA3Update_x4(uint64_t* st)
+{
+	KECCAK_PERMUTE_X(__m256i, VLOAD, VSTORE)
+}
+#undef VXOR
+#undef VANDN
+#undef VROL
+#undef VRC
+#undef VLOAD
+#undef VSTORE
+
+//AVX-512F8{
+//GCC̈ꕔ̃o[WtargetŎgAVX-512̑gݍ݊֐ɖ̌xôŗ}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+#define VXOR(a, b)		_mm512_xor_si512(a, b)
+#define VANDN(a, b)		_mm512_andnot_si512(a, b)
+#define VROL(a, n)		_mm512_rol_epi64(a, n)
+#define VRC(rnd)		_mm512_set1_epi64((long long)c_anRoundConstant[rnd])
+#define VLOAD(w)		_mm512_loadu_si512((const void*)(st + (w) * SHA3_LANES_MAX))
+#define VSTORE(w, v)	_mm512_storeu_si512((void*)(st + (w) * SHA3_LANES_MAX), v)
+SHA3_AVX512_TARGET static void SHA3Update_x8(uint64_t* st)
+{
+	KECCAK_PERMUTE_X(__m512i, VLOAD, VSTORE)
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+#undef VXOR
+#undef VANDN
+#undef VROL
+#undef VRC
+#undef VLOAD
+#undef VSTORE
+
+#undef KECCAK_PERMUTE_X
+#undef KECCAK_ROUND_X
+
+//OSYMM/ZMMWX^ۑ邩܂߂ĊmF
+static size_t SHA3CheckLanes()
+{
+	unsigned int r1[4], r7[4]; uint64_t xcr0;
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0); if (info[0] < 7) return 1;
+	__cpuid(info, 1); memcpy(r1, info, sizeof(r1));
+	__cpuidex(info, 7, 0); memcpy(r7, info, sizeof(r7));
+	if (!(r1[2] & (1 << 27))) return 1;
+	xcr0 = _xgetbv(0);
+#else
+	unsigned int lo, hi;
+	if (__get_cpuid_max(0, NULL) < 7) return 1;
+	__cpuid(1, r1[0], r1[1], r1[2], r1[3]);
+	__cpuid_count(7, 0, r7[0], r7[1], r7[2], r7[3]);
+	if (!(r1[2] & (1 << 27))) return 1;
+	__asm__("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+	xcr0 = (uint64_t)hi << 32 | lo;
+#endif
+	if ((r7[1] & (1 << 16)) && (xcr0 & 0xe6) == 0xe6) return 8;
+	if ((r7[1] & (1 << 5)) && (xcr0 & 0x06) == 0x06) return 4;
+	return 1;
+}
+
+static const size_t c_nSHA3Lanes = SHA3CheckLanes();
+#else
+static const size_t c_nSHA3Lanes = 1;
+#endif //SHA3_SIMD_SUPPORTED
+
+//lanes{ԂׂċzBbZ[WƂɃubNႤ̂ŁAŌ̃ubNz[猋ʂo
+static void SHA3_xN(const void* const* _data, const size_t* _len, unsigned char* hash, size_t num, size_t hashlen, size_t lanes, SHA3_PERMUTE_X permute)
+{
+	const size_t blen = SHA3_BLOCKSIZE - 2 * hashlen, words = blen / SHA3_WORD;
+	uint64_t st[25 * SHA3_LANES_MAX], word;
+	unsigned char last[SHA3_LANES_MAX][SHA3_BLOCKSIZE];
+	const unsigned char* data; size_t base, count, blocks[SHA3_LANES_MAX], maxblocks, tail, b, j, w;
+
+	for (base = 0; base < num; base += lanes) {
+		count = (num - base < lanes) ? num - base : lanes;
+		memset(st, 0x00, sizeof(st));
+		maxblocks = 0;
+		for (j = 0; j < count; j++) {
+			data = (const unsigned char*)_data[base + j];
+			blocks[j] = _len[base + j] / blen + 1;
+			tail = _len[base + j] % blen;
+			memset(last[j], 0x00, blen);
+			memcpy(last[j], data + (blocks[j] - 1) * blen, tail);
+			last[j][tail] ^= 0x01;
+			last[j][blen - 1] ^= 0x80;
+			if (maxblocks < blocks[j]) maxblocks = blocks[j];
+		}
+
+		for (b = 0; b < maxblocks; b++) {
+			for (j = 0; j < count; j++) {
+				if (b >= blocks[j]) continue;
+				data = (b == blocks[j] - 1) ? last[j] : (const unsigned char*)_data[base + j] + b * blen;
+				for (w = 0; w < words; w++) {
+					memcpy(&word, data + w * SHA3_WORD, SHA3_WORD);
+					st[w * SHA3_LANES_MAX + j] ^= SetLittleEndian(word);
+				}
+			}
+			permute(st);
+			for (j = 0; j < count; j++) {
+				if (b != blocks[j] - 1) continue;
+				for (w = 0; w < hashlen / SHA3_WORD; w++) {
+					word = SetLittleEndian(st[w * SHA3_LANES_MAX + j]);
+					memcpy(hash + (base + j) * hashlen + w * SHA3_WORD, &word, SHA3_WORD);
+				}
+			}
+		}
+	}
+}
+
+void SHA3_384_xN(const void* const* _data, const size_t* _len, void* _hash, size_t _num)
+{
+	size_t i;
+
+#ifdef SHA3_SIMD_SUPPORTED
+	if (c_nSHA3Lanes == 8) return SHA3_xN(_data, _len, (unsigned char*)_hash, _num, 48, 8, SHA3Update_x8);
+	if (c_nSHA3Lanes == 4) return SHA3_xN(_data, _len, (unsigned char*)_hash, _num, 48, 4, SHA3Update_x4);
+#endif
+	for (i = 0; i < _num; i++) SHA3_384((void*)_data[i], _len[i], (unsigned char*)_hash + i * 48);
+}
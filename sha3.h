@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <cstdint>
 
 typedef struct _sha3ctx {
@@ -18,3 +19,7 @@ void SHA3_224(void* _data, size_t _len, void* _hash);
 void SHA3_256(void* _data, size_t _len, void* _hash);
 void SHA3_384(void* _data, size_t _len, void* _hash);
 void SHA3_512(void* _data, size_t _len, void* _hash);
+
+//_num̓͂܂Ƃ߂ănbVA_hash48oCgׂď
+//AVX-512Ȃ8{AAVX2Ȃ4{SIMDœɌvZAǂȂSHA3_384ɌĂ
+void SHA3_384_xN(const void* const* _data, const size_t* _len, void* _hash, size_t _num);
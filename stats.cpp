@@ -0,0 +1,229 @@
+#include "stats.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+static const char* const phase_names[ARCHIVE_PHASE_NUM] = { "scan", "header", "key", "read", "checksum", "compress", "crypt", "write", "wait" };
+
+// L^ԁBnamenullptrȂiK̋
+struct TRACE_EVENT {
+	const char* name;
+	ARCHIVE_PHASE phase;
+	uint32_t thread;
+	uint64_t begin, duration;	// imbibeginARCHIVE_TRACE::startj
+	uint64_t in, out;
+};
+
+// Ԃ͏IƂɌĒǉ
+struct ARCHIVE_TRACE {
+	std::mutex lock;
+	std::vector<TRACE_EVENT> events;
+	uint64_t start;
+};
+
+// ARCHIVE_STATSɕʁX̃XbȟĂяoZƂ̂
+static std::mutex stats_lock;
+// ̃XbhłܐĂSTATS_SPANiq̓̎ԂO珜߁j
+static thread_local STATS_SPAN* current_span = nullptr;
+// traceɋL^Xbh̔ԍiŏɋL^Xbh珇ɐUj
+static std::atomic<uint32_t> thread_count{ 0 };
+static thread_local uint32_t thread_number = 0;
+
+static uint64_t WallNow()
+{
+	return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#ifdef _WIN32
+static uint64_t FileTimeToNs(const FILETIME& kernel, const FILETIME& user)
+{
+	const uint64_t k = (uint64_t)kernel.dwHighDateTime << 32 | kernel.dwLowDateTime;
+	const uint64_t u = (uint64_t)user.dwHighDateTime << 32 | user.dwLowDateTime;
+	return (k + u) * 100;
+}
+
+static uint64_t ThreadCpuNow()
+{
+	FILETIME create, exit, kernel, user;
+	if (!GetThreadTimes(GetCurrentThread(), &create, &exit, &kernel, &user)) return 0;
+	return FileTimeToNs(kernel, user);
+}
+
+static uint64_t ProcessCpuNow()
+{
+	FILETIME create, exit, kernel, user;
+	if (!GetProcessTimes(GetCurrentProcess(), &create, &exit, &kernel, &user)) return 0;
+	return FileTimeToNs(kernel, user);
+}
+#else
+static uint64_t ClockNow(clockid_t clock)
+{
+	timespec ts;
+	if (clock_gettime(clock, &ts) != 0) return 0;
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint64_t ThreadCpuNow()
+{
+	return ClockNow(CLOCK_THREAD_CPUTIME_ID);
+}
+
+static uint64_t ProcessCpuNow()
+{
+	return ClockNow(CLOCK_PROCESS_CPUTIME_ID);
+}
+#endif
+
+static uint32_t ThreadNumber()
+{
+	if (thread_number == 0) thread_number = ++thread_count;
+	return thread_number;
+}
+
+static void AddTraceEvent(ARCHIVE_TRACE* trace, const char* name, ARCHIVE_PHASE phase, uint64_t begin, uint64_t end, uint64_t in, uint64_t out)
+{
+	const TRACE_EVENT event = { name, phase, ThreadNumber(), begin - std::min(begin, trace->start), end - begin, in, out };
+	std::lock_guard<std::mutex> lock(trace->lock);
+	trace->events.push_back(event);
+}
+
+STATS_SCOPE::STATS_SCOPE(ARCHIVE_STATS* _stats, ARCHIVE_TRACE* _trace, const char* _name) : stats(_stats), trace(_trace), name(_name), active(_stats || _trace)
+{
+	for (int p = 0; p < ARCHIVE_PHASE_NUM; p++)
+		wall[p] = cpu[p] = bytes_in[p] = bytes_out[p] = calls[p] = 0;
+	allocations = peak_buffer = 0;
+	start_wall = active ? WallNow() : 0;
+	start_cpu = stats ? ProcessCpuNow() : 0;
+}
+
+STATS_SCOPE::~STATS_SCOPE()
+{
+	if (!active) return;
+	const uint64_t end_wall = WallNow();
+	if (trace && name)
+		AddTraceEvent(trace, name, ARCHIVE_PHASE_NUM, start_wall, end_wall, bytes_in[ARCHIVE_PHASE_HEADER] + bytes_in[ARCHIVE_PHASE_READ], bytes_out[ARCHIVE_PHASE_HEADER] + bytes_out[ARCHIVE_PHASE_WRITE]);
+	if (!stats) return;
+	const double total_wall = (end_wall - start_wall) * 1e-9, total_cpu = (ProcessCpuNow() - start_cpu) * 1e-9;
+
+	std::lock_guard<std::mutex> lock(stats_lock);
+	ARCHIVE_STATS& t = *stats;
+	for (int p = 0; p < ARCHIVE_PHASE_NUM; p++)
+	{
+		ARCHIVE_PHASE_STATS& phase = t.phases[p];
+		phase.wall += wall[p] * 1e-9;
+		phase.cpu += cpu[p] * 1e-9;
+		phase.bytes_in += bytes_in[p];
+		phase.bytes_out += bytes_out[p];
+		phase.calls += calls[p];
+	}
+	t.wall += total_wall;
+	t.cpu += total_cpu;
+	t.bytes_in += bytes_in[ARCHIVE_PHASE_HEADER] + bytes_in[ARCHIVE_PHASE_READ];
+	t.bytes_out += bytes_out[ARCHIVE_PHASE_HEADER] + bytes_out[ARCHIVE_PHASE_WRITE];
+	t.allocations += allocations;
+	t.peak_buffer = std::max<uint64_t>(t.peak_buffer, peak_buffer);
+	t.calls++;
+}
+
+void StatsAlloc(STATS_SCOPE* s, uint64_t size)
+{
+	if (!s || !s->active) return;
+	s->allocations++;
+	uint64_t peak = s->peak_buffer;
+	while (peak < size && !s->peak_buffer.compare_exchange_weak(peak, size));
+}
+
+void StatsBytes(STATS_SCOPE* s, ARCHIVE_PHASE phase, uint64_t in, uint64_t out)
+{
+	if (!s || !s->active) return;
+	s->bytes_in[phase] += in;
+	s->bytes_out[phase] += out;
+}
+
+void STATS_SPAN::Begin(ARCHIVE_PHASE p, uint64_t _in, uint64_t _out)
+{
+	phase = p;
+	in = _in;
+	out = _out;
+	child_wall = child_cpu = 0;
+	parent = current_span;
+	current_span = this;
+	scope->bytes_in[p] += in;
+	scope->bytes_out[p] += out;
+	scope->calls[p]++;
+	wall = WallNow();
+	cpu = scope->stats ? ThreadCpuNow() : 0;
+}
+
+void STATS_SPAN::End()
+{
+	const uint64_t end = WallNow();
+	const uint64_t w = end - wall, c = scope->stats ? ThreadCpuNow() - cpu : 0;
+	if (scope->trace) AddTraceEvent(scope->trace, nullptr, phase, wall, end, in, out);
+	scope->wall[phase] += w - std::min(w, child_wall);
+	scope->cpu[phase] += c - std::min(c, child_cpu);
+	current_span = parent;
+	if (!parent) return;
+	parent->child_wall += w;
+	parent->child_cpu += c;
+}
+
+void PrintArchiveStats(const ARCHIVE_STATS& stats, std::ostream& out)
+{
+	const auto flags = out.flags();
+	const auto precision = out.precision();
+	out << std::fixed << std::setprecision(3);
+	out << std::setw(10) << "phase" << std::setw(12) << "wall (s)" << std::setw(12) << "cpu (s)" << std::setw(14) << "in (MB)" << std::setw(14) << "out (MB)" << std::setw(12) << "calls" << std::endl;
+	for (int p = 0; p < ARCHIVE_PHASE_NUM; p++)
+	{
+		const ARCHIVE_PHASE_STATS& phase = stats.phases[p];
+		if (phase.calls == 0) continue;
+		out << std::setw(10) << phase_names[p] << std::setw(12) << phase.wall << std::setw(12) << phase.cpu
+			<< std::setw(14) << phase.bytes_in / (1024.0 * 1024.0) << std::setw(14) << phase.bytes_out / (1024.0 * 1024.0) << std::setw(12) << phase.calls << std::endl;
+	}
+	out << std::setw(10) << "total" << std::setw(12) << stats.wall << std::setw(12) << stats.cpu
+		<< std::setw(14) << stats.bytes_in / (1024.0 * 1024.0) << std::setw(14) << stats.bytes_out / (1024.0 * 1024.0) << std::setw(12) << stats.calls << std::endl;
+	out << "buffers: " << stats.allocations << " allocations, largest " << stats.peak_buffer / (1024.0 * 1024.0) << " MB" << std::endl;
+	out.flags(flags);
+	out.precision(precision);
+}
+
+ARCHIVE_TRACE* CreateArchiveTrace()
+{
+	ARCHIVE_TRACE* trace = new ARCHIVE_TRACE;
+	trace->start = WallNow();
+	return trace;
+}
+
+void DestroyArchiveTrace(ARCHIVE_TRACE* trace)
+{
+	delete trace;
+}
+
+// Ԃ͊SȃCxgi"ph": "X"jƂďoA̓}CNbɂ
+bool WriteArchiveTrace(const ARCHIVE_TRACE* trace, const std::string& path)
+{
+	std::ofstream ofs(path);
+	ofs << std::fixed << std::setprecision(3);
+	ofs << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+	ofs << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 0, \"args\": {\"name\": \"Archive\"}}";
+	for (const TRACE_EVENT& e : trace->events)
+	{
+		ofs << ",\n{\"name\": \"" << (e.name ? e.name : phase_names[e.phase]) << "\", \"cat\": \"" << (e.name ? "call" : "phase") << "\", \"ph\": \"X\"";
+		ofs << ", \"ts\": " << e.begin / 1000.0 << ", \"dur\": " << e.duration / 1000.0 << ", \"pid\": 1, \"tid\": " << e.thread;
+		ofs << ", \"args\": {\"bytes_in\": " << e.in << ", \"bytes_out\": " << e.out << "}}";
+	}
+	ofs << "\n]}\n";
+	return (bool)ofs;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include "archive.h"
+#include <atomic>
+
+// Ăяo1񕪂̓B̃Xbh琔AXR[v𔲂ƂARCHIVE_STATSɂ܂Ƃ߂ĉZB
+// traceΒiKƂ̋ԂƁAnametĂяoŜ̋ԂL^B
+// statstracenullptrȂ牽AȂB
+struct STATS_SCOPE {
+	ARCHIVE_STATS* stats;
+	ARCHIVE_TRACE* trace;
+	const char* name;
+	bool active;
+	std::atomic<uint64_t> wall[ARCHIVE_PHASE_NUM], cpu[ARCHIVE_PHASE_NUM];	// imb
+	std::atomic<uint64_t> bytes_in[ARCHIVE_PHASE_NUM], bytes_out[ARCHIVE_PHASE_NUM], calls[ARCHIVE_PHASE_NUM];
+	std::atomic<uint64_t> allocations, peak_buffer;
+	uint64_t start_wall, start_cpu;
+
+	STATS_SCOPE(ARCHIVE_STATS* _stats, ARCHIVE_TRACE* _trace, const char* _name);
+	~STATS_SCOPE();
+	STATS_SCOPE(const STATS_SCOPE&) = delete;
+	STATS_SCOPE& operator=(const STATS_SCOPE&) = delete;
+};
+
+// Ɨp̃obt@mۂƂ𐔂
+void StatsAlloc(STATS_SCOPE* s, uint64_t size);
+void StatsBytes(STATS_SCOPE* s, ARCHIVE_PHASE phase, uint64_t in, uint64_t out);
+
+// XR[v𔲂܂ł̎ԂphaseɐBXbh̒œqɂƁA̎Ԃ͊O珜
+// itraceɂ͓܂߂Ԃ̂܂܋L^j
+struct STATS_SPAN {
+	STATS_SCOPE* scope;
+	STATS_SPAN* parent;
+	ARCHIVE_PHASE phase;
+	uint64_t wall, cpu, child_wall, child_cpu;
+	uint64_t in, out;
+
+	STATS_SPAN(STATS_SCOPE* s, ARCHIVE_PHASE p, uint64_t _in = 0, uint64_t _out = 0) : scope(s && s->active ? s : nullptr) { if (scope) Begin(p, _in, _out); }
+	~STATS_SPAN() { if (scope) End(); }
+	STATS_SPAN(const STATS_SPAN&) = delete;
+	STATS_SPAN& operator=(const STATS_SPAN&) = delete;
+
+private:
+	void Begin(ARCHIVE_PHASE p, uint64_t in, uint64_t out);
+	void End();
+};